@@ -0,0 +1,185 @@
+#include "BandBlender.h"
+
+bool BandBlender::blend(const vector<Mat>& images, const vector<Mat>& masks, const vector<Point>& corners, OutputWriter& writer) {
+	Rect canvas;
+	for (int i = 0; i < images.size(); i++) {
+		Rect roi(corners[i], images[i].size());
+		canvas = canvas.empty() ? roi : (canvas | roi);
+	}
+	if (canvas.empty() || !writer.open(canvas.size()))
+		return false;
+
+	vector<Rect> rois(images.size());
+	for (int i = 0; i < images.size(); i++)
+		rois[i] = Rect(corners[i] - canvas.tl(), images[i].size());
+
+	// only the overlaps of the images (and their surroundings) need the pyramids.
+	RoiIndex roiIndex;
+	roiIndex.build(rois);
+	vector<pair<int, int>> pairs;
+	vector<Rect> overlap_rects;
+	roiIndex.overlaps(pairs, overlap_rects);
+
+	// the halo must cover the filters of all levels, the band must not be smaller than the halo.
+	int halo = getHalo();
+	int band_height = alignUp(max(bandHeight, halo));
+
+	vector<int> band_starts;
+	for (int y = 0; y < canvas.height; y += band_height)
+		band_starts.push_back(y);
+
+	// the bands are blended in groups of one band per thread, each group is written before the next one starts.
+	int threads = omp_get_max_threads();
+	for (int first = 0; first < band_starts.size(); first += threads) {
+		int count = min(threads, (int)band_starts.size() - first);
+		vector<Mat> bands(count);
+
+#pragma omp parallel for schedule(dynamic)
+		for (int k = 0; k < count; k++) {
+			int y0 = band_starts[first + k];
+			int y1 = min(y0 + band_height, canvas.height);
+			blendBand(images, masks, rois, overlap_rects, canvas.width, canvas.height, y0, y1, bands[k]);
+		}
+
+		for (int k = 0; k < count; k++)
+			writer.writeRows(bands[k]);
+		cout << "Blended rows " << min(band_starts[first + count - 1] + band_height, canvas.height) << "/" << canvas.height << endl;
+	}
+
+	writer.close();
+	return writer.good();
+}
+
+void BandBlender::blendBand(const vector<Mat>& images, const vector<Mat>& masks, const vector<Rect>& rois, const vector<Rect>& overlap_rects,
+	int width, int height, int y0, int y1, Mat& band) {
+	int align = 1 << numBands;
+	int halo = getHalo();
+
+	/*
+		Outside of the overlaps only one image covers a pixel, and the collapsed pyramid of a single image is the image itself,
+		so the pixels of the images are copied first. Then the columns around the overlaps of the band are blended.
+	*/
+	band = Mat::zeros(y1 - y0, width, CV_8UC3);
+	Rect band_rect(0, y0, width, y1 - y0);
+	for (int i = 0; i < images.size(); i++) {
+		Rect part = rois[i] & band_rect;
+		if (part.empty())
+			continue;
+		images[i](part - rois[i].tl()).copyTo(band(part - band_rect.tl()), masks[i](part - rois[i].tl()));
+	}
+
+	// the columns influenced by an overlap (aligned to the pyramid of the canvas), merged when they touch.
+	vector<pair<int, int>> ranges;
+	for (int k = 0; k < overlap_rects.size(); k++) {
+		const Rect& o = overlap_rects[k];
+		if (o.y >= y1 + halo || o.br().y <= y0 - halo)
+			continue;
+		ranges.push_back(make_pair(max(0, (o.x - halo) / align * align), min(alignUp(width), alignUp(o.br().x + halo))));
+	}
+	sort(ranges.begin(), ranges.end());
+	vector<pair<int, int>> merged;
+	for (int k = 0; k < ranges.size(); k++) {
+		if (!merged.empty() && ranges[k].first <= merged.back().second)
+			merged.back().second = max(merged.back().second, ranges[k].second);
+		else
+			merged.push_back(ranges[k]);
+	}
+
+	for (int k = 0; k < merged.size(); k++) {
+		Rect area(merged[k].first, y0, min(merged[k].second, width) - merged[k].first, y1 - y0);
+		if (area.width > 0)
+			blendArea(images, masks, rois, width, height, area, band(area - band_rect.tl()));
+	}
+}
+
+void BandBlender::blendArea(const vector<Mat>& images, const vector<Mat>& masks, const vector<Rect>& rois, int width, int height,
+	Rect area_out, Mat dst) {
+	int align = 1 << numBands;
+	int halo = getHalo();
+
+	// the area with the halo around it, aligned to the pyramid of the whole canvas.
+	int ex0 = max(0, (area_out.x - halo) / align * align);
+	int ex1 = min(alignUp(width), alignUp(area_out.br().x + halo));
+	int ey0 = max(0, (area_out.y - halo) / align * align);
+	int ey1 = min(alignUp(height), alignUp(area_out.br().y + halo));
+	Rect extended(ex0, ey0, ex1 - ex0, ey1 - ey0);
+
+	// weighted sums of the Laplacian levels (int32) and the sums of the weights.
+	vector<Mat> dst_laplace(numBands + 1), dst_weight(numBands + 1);
+	for (int l = 0; l <= numBands; l++) {
+		dst_laplace[l] = Mat::zeros(extended.height >> l, extended.width >> l, CV_32SC3);
+		dst_weight[l] = Mat::zeros(extended.height >> l, extended.width >> l, CV_32S);
+	}
+
+	for (int i = 0; i < images.size(); i++) {
+		Rect part = rois[i] & extended;
+		if (part.empty())
+			continue;
+
+		/*
+			The image is cut with a gap around its part, so the pyramid is correct near the border of the part.
+			The area outside of the image is filled by reflecting the image (as in OpenCV's blender), and its weight is 0.
+		*/
+		int gap = halo;
+		Rect area = Rect(part.x - gap, part.y - gap, part.width + 2 * gap, part.height + 2 * gap) & extended;
+		int ax0 = extended.x + ((area.x - extended.x) / align) * align;
+		int ay0 = extended.y + ((area.y - extended.y) / align) * align;
+		int ax1 = extended.x + alignUp(area.br().x - extended.x);
+		int ay1 = extended.y + alignUp(area.br().y - extended.y);
+		area = Rect(ax0, ay0, ax1 - ax0, ay1 - ay0);
+
+		Rect valid = rois[i] & area;
+		Rect source = valid - rois[i].tl();
+		int top = valid.y - area.y, bottom = area.br().y - valid.br().y;
+		int left = valid.x - area.x, right = area.br().x - valid.br().x;
+
+		// int16 image and weights in [0, WEIGHT_ONE].
+		Mat src, mask;
+		copyMakeBorder(images[i](source), src, top, bottom, left, right, BORDER_REFLECT);
+		copyMakeBorder(masks[i](source), mask, top, bottom, left, right, BORDER_CONSTANT, Scalar(0));
+		src.convertTo(src, CV_16SC3);
+		mask.convertTo(mask, CV_16S, (double)PyramidKernels::WEIGHT_ONE / 255.0);
+
+		// Laplacian pyramid of the image and Gaussian pyramid of its weights.
+		vector<Mat> levels(numBands + 1), weights(numBands + 1);
+		levels[0] = src;
+		weights[0] = mask;
+		for (int l = 0; l < numBands; l++) {
+			kernels.pyrDown(levels[l], levels[l + 1]);
+			kernels.pyrDown(weights[l], weights[l + 1]);
+		}
+		for (int l = 0; l < numBands; l++)
+			kernels.pyrUpAdd(levels[l + 1], levels[l], -1);
+
+		// weighted accumulation into the pyramid of the band.
+		for (int l = 0; l <= numBands; l++)
+			kernels.accumulate(levels[l], weights[l], dst_laplace[l], dst_weight[l], Point((area.x - extended.x) >> l, (area.y - extended.y) >> l));
+	}
+
+	// normalization of each level and collapse of the pyramid.
+	vector<Mat> levels(numBands + 1);
+	for (int l = 0; l <= numBands; l++)
+		kernels.normalize(dst_laplace[l], dst_weight[l], levels[l]);
+	for (int l = numBands; l > 0; l--)
+		kernels.pyrUpAdd(levels[l], levels[l - 1], 1);
+
+	// only the pixels of the area are kept, the pixels which are not covered by any image are black.
+	for (int y = 0; y < area_out.height; y++) {
+		const short* src = levels[0].ptr<short>(y + area_out.y - ey0) + 3 * (area_out.x - ex0);
+		const int* w = dst_weight[0].ptr<int>(y + area_out.y - ey0) + (area_out.x - ex0);
+		uchar* d = dst.ptr<uchar>(y);
+		for (int x = 0; x < area_out.width; x++) {
+			for (int c = 0; c < 3; c++)
+				d[3 * x + c] = w[x] > 0 ? saturate_cast<uchar>(src[3 * x + c]) : 0;
+		}
+	}
+}
+
+int BandBlender::alignUp(int n) {
+	int align = 1 << numBands;
+	return (n + align - 1) / align * align;
+}
+
+int BandBlender::getHalo() {
+	return 4 << numBands;
+}
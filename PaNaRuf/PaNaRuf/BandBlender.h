@@ -0,0 +1,80 @@
+#ifndef  BAND_BLENDER_H
+#define  BAND_BLENDER_H
+
+#include <iostream>
+#include <algorithm>
+#include <omp.h>
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+#include "OutputWriter.h"
+#include "PyramidKernels.h"
+#include "RoiIndex.h"
+
+using namespace std;
+using namespace cv;
+
+/*
+	Multi-band blender which processes the panorama canvas in horizontal bands.
+
+	OpenCV's MultiBandBlender keeps the Laplacian pyramid of the whole canvas in memory.
+	Here, each band of rows is blended on its own: the images covering the band are cut with a halo
+	of rows above and below the band (the support of the pyramid filters grows with the number of levels),
+	their Laplacian pyramids are accumulated into the pyramid of the band, and the band is collapsed.
+	Only the rows of the band itself are kept, so the bands do not depend on each other.
+
+	* Several bands are blended at the same time (one per thread), and the finished bands are given to the
+	  writer in order, so the memory use is about (threads x band height x canvas width x levels).
+	* The pyramids are int16 with int32 weighted sums (see PyramidKernels), the 8-bit images are converted once per band.
+	* Most of the canvas is covered by a single image: only the columns around the overlaps of the images (RoiIndex)
+	  are blended, the rest of the band is copied from the images.
+	* The pyramids of the bands are aligned to the pyramid of the whole canvas (the band rows are multiples of 2^numBands),
+	  so the bands match at their borders.
+*/
+class BandBlender {
+
+public:
+	// Number of pyramid levels (0 -> the overlapping images are only averaged).
+	int numBands = 5;
+
+	// Minimum number of rows of a band (it is increased to a multiple of 2^numBands and to at least the halo).
+	int bandHeight = 256;
+
+	/*
+		Blends the images (CV_8UC3) with their masks (CV_8U) placed at "corners" on the canvas
+		and writes the panorama to "writer". Returns false if the output can not be created or written.
+	*/
+	bool blend(const vector<Mat>& images, const vector<Mat>& masks, const vector<Point>& corners, OutputWriter& writer);
+
+private:
+	// Fixed-point pyramid kernels.
+	PyramidKernels kernels;
+
+	/*
+		Blends the canvas rows [y0, y1) into "band" (CV_8UC3).
+		* rois -> the areas of the images on the canvas (relative to its top-left corner).
+		* overlap_rects -> the intersections of the rois, only the columns around them are blended with the pyramids.
+	*/
+	void blendBand(const vector<Mat>& images, const vector<Mat>& masks, const vector<Rect>& rois, const vector<Rect>& overlap_rects,
+		int width, int height, int y0, int y1, Mat& band);
+
+	/*
+		Blends the canvas area "area_out" with the pyramids (using a halo around it) and writes it to dst.
+	*/
+	void blendArea(const vector<Mat>& images, const vector<Mat>& masks, const vector<Rect>& rois, int width, int height,
+		Rect area_out, Mat dst);
+
+	/*
+		Rounds n up to a multiple of 2^numBands.
+	*/
+	int alignUp(int n);
+
+	/*
+		Number of canvas pixels which influence a pixel of the collapsed pyramid: the 5-tap pyrDown reaches
+		2 pixels of each finer level (2^(numBands + 1) - 2 pixels of the canvas) and the collapse adds 1 pixel
+		of each coarser level again, so 2^(numBands + 2) - 4 < 4 << numBands.
+		It is used both for the halo of the blended areas and for the gap around the cut images.
+	*/
+	int getHalo();
+};
+
+#endif
@@ -1,7 +1,7 @@
 #include "Blending.h"
 
-void Blending::applyMultiBandBlending(vector<Mat> warped_masks, vector<Mat> warped_images,
-	vector<Point> corners, vector<Size> sizes, Mat& result
+bool Blending::applyMultiBandBlending(const vector<Mat>& warped_masks, const vector<Mat>& warped_images,
+	const vector<Point>& corners, const vector<Size>& sizes, OutputWriter& writer
 ) {
 
 	/*
@@ -12,71 +12,171 @@ void Blending::applyMultiBandBlending(vector<Mat> warped_masks, vector<Mat> warp
 			  and arranged for our software.
 	*/
 
+	// the warped images and masks are only read, the seams are written to new masks.
+	vector<Mat> seam_masks;
+	findSeams(warped_masks, warped_images, corners, sizes, seam_masks);
+
+	/*
+		Multi-band blending of the canvas band by band (see BandBlender),
+		the 8-bit warped images are read directly by the blender.
+	*/
+	BandBlender blender;
+	float blend_width = sqrt((float)(resultRoi(corners, sizes).size().area())) * 5 / 100.f; // finding blend width
+	cout << "Blend width = " << blend_width << endl;
+	if (blend_width < 1.f) // if the blend width is less than 1, the overlapping images are only averaged (no pyramid).
+		blender.numBands = 0;
+	else
+		blender.numBands = max(0, (int)(ceil(log(blend_width) / log(2.)) - 1.)); // calculation of number of bands
+	return blender.blend(warped_images, seam_masks, corners, writer);
+}
+
+void Blending::applyMultiBandBlending(const vector<Mat>& warped_masks, const vector<Mat>& warped_images,
+	const vector<Point>& corners, const vector<Size>& sizes, Mat& result
+) {
+	MatWriter writer;
+	applyMultiBandBlending(warped_masks, warped_images, corners, sizes, writer);
+	result = writer.result;
+}
+
+void Blending::findSeams(const vector<Mat>& warped_masks, const vector<Mat>& warped_images,
+	const vector<Point>& corners, const vector<Size>& sizes, vector<Mat>& seam_masks) {
+
+	/*
+		The seams are found on a downscaled proxy of the warped images and masks (the corners are scaled with them).
+		Only the proxy is converted to float, and the Voronoi seam finder does not read the images at all,
+		so its proxy is not converted.
+	*/
+	double seam_scale = getSeamScale(sizes);
+	cout << "Seam scale = " << seam_scale << endl;
+
 	vector<UMat> umats_masks(warped_masks.size());
 	vector<UMat> umats_images(warped_images.size());
+	vector<Point> seam_corners(corners.size());
 
+#pragma omp parallel for
 	for (int i = 0; i < warped_masks.size(); i++) {
 
-		warped_masks[i].copyTo(umats_masks[i]);
-		warped_images[i].copyTo(umats_images[i]);
-
-		umats_images[i].convertTo(umats_images[i], CV_32F);
+		if (seam_scale < 1.0) {
+			Size seam_size(max(1, cvRound(warped_images[i].cols * seam_scale)), max(1, cvRound(warped_images[i].rows * seam_scale)));
+			resize(warped_images[i], umats_images[i], seam_size, 0, 0, INTER_AREA);
+			resize(warped_masks[i], umats_masks[i], seam_size, 0, 0, INTER_NEAREST);
+		}
+		else {
+			// the seam finder writes to the masks, so they are copied, the images are read in place.
+			warped_masks[i].copyTo(umats_masks[i]);
+			umats_images[i] = warped_images[i].getUMat(ACCESS_READ);
+		}
+		seam_corners[i] = Point(cvRound(corners[i].x * seam_scale), cvRound(corners[i].y * seam_scale));
 
+		if (seamFinderType != VORONOI_SEAM)
+			umats_images[i].convertTo(umats_images[i], CV_32F);
 	}
 
 	cout << "Finding seams..." << endl;
-	
-	/*
-		VoronoiSeamFinder is faster than GraphCutSeamFinder but 
-		the quality of the final image is vice versa.
 
-		So, depending on the intention, one can comment/un-comment any of them below,
-		to choose for finding the seams among the warped images.
-	*/
+	// the pairs of images which overlap (at the seam scale) and their overlaps.
+	vector<Rect> seam_rois(umats_images.size());
+	for (int i = 0; i < umats_images.size(); i++)
+		seam_rois[i] = Rect(seam_corners[i], umats_images[i].size());
+	RoiIndex roiIndex;
+	roiIndex.build(seam_rois);
+	vector<pair<int, int>> pairs;
+	vector<Rect> overlap_rects;
+	roiIndex.overlaps(pairs, overlap_rects);
 
-	//Ptr<SeamFinder> seam_finder = makePtr<VoronoiSeamFinder>();
+	/*
+		The seam of each pair only changes the masks of its two images, so the pairs are grouped into batches
+		in which no image appears twice (greedy coloring), and the pairs of a batch are processed in parallel.
+	*/
+	vector<vector<int>> batches;
+	vector<vector<bool>> used;
+	for (int k = 0; k < pairs.size(); k++) {
+		int b = 0;
+		while (b < batches.size() && (used[b][pairs[k].first] || used[b][pairs[k].second]))
+			b++;
+		if (b == batches.size()) {
+			batches.push_back(vector<int>());
+			used.push_back(vector<bool>(umats_images.size(), false));
+		}
+		batches[b].push_back(k);
+		used[b][pairs[k].first] = used[b][pairs[k].second] = true;
+	}
 
-	Ptr<SeamFinder> seam_finder =  makePtr<GraphCutSeamFinder>(GraphCutSeamFinderBase::COST_COLOR); 
+	for (int b = 0; b < batches.size(); b++) {
+#pragma omp parallel for schedule(dynamic)
+		for (int k = 0; k < batches[b].size(); k++) {
+			int p = batches[b][k];
+			findSeamInPair(pairs[p].first, pairs[p].second, overlap_rects[p], umats_images, seam_rois, umats_masks);
+		}
+	}
 
-	seam_finder->find(umats_images, corners, umats_masks); //this estimates the seams using corners and images_warped and assigning to masks_warped
+	cout << "Seams found (" << pairs.size() << " overlapping pairs)" << endl;
+	umats_images.clear();
 
-	cout << "Seams found" << endl;
+	/*
+		The seam masks are dilated and upscaled to the compose scale, the dilation keeps a small overlap
+		along the seams, which the blender needs.
+	*/
+	seam_masks.resize(warped_masks.size());
+#pragma omp parallel for
 	for (int i = 0; i < warped_masks.size(); i++) {
 
-		umats_images[i].convertTo(umats_images[i], CV_8UC3);
-
 		Mat dilated_mask, seam_mask;
 		dilate(umats_masks[i], dilated_mask, Mat()); // we are enlarging warped masks and store in dilated mask
 		resize(dilated_mask, seam_mask, warped_masks[i].size(), 0, 0, INTER_LINEAR_EXACT); //resizing dilated mask by warped mask size, store to seam mask
-		warped_masks[i] = seam_mask & warped_masks[i];
+		bitwise_and(seam_mask, warped_masks[i], seam_masks[i]);
 	}
+}
 
-
-	Ptr<Blender> blender;
-	for (int i = 0; i < warped_images.size(); i++) {
-
-		if (i == 0) // only in the first iteration we need to initialize our multi-band blender
-		{
-			float blend_width = sqrt((float)(resultRoi(corners, sizes).size().area())) * 5 / 100.f; // finding blend width
-			cout << "Blend width = " << blend_width << endl;
-			if (blend_width < 1.f) // check if the blend width above is less than 1 
-				blender = Blender::createDefault(Blender::NO, false); // if it is less than 1 then we create blender with type NO which means simple blender putting over another. We do not try gpu so it is false.
-			else
-			{
-				blender = Blender::createDefault(Blender::MULTI_BAND, false); // if it is greater/equal than 1, then we create blender with type MULTO_BAND. We do not try gpu that's why it is false.
-				MultiBandBlender* mb = dynamic_cast<MultiBandBlender*>(blender.get()); // We use multi-band blender algorithm for blending
-				mb->setNumBands((int)(ceil(log(blend_width) / log(2.)) - 1.)); // calculation of number of bands and setting to our mb object
-			}
-			blender->prepare(corners, sizes); //Preparation to blending
-
-		}
-
-		warped_images[i].convertTo(warped_images[i], CV_16S); //Change type of warped image from 8bit unsigned int to 16 bit signed int 
-
-		blender->feed(warped_images[i], warped_masks[i], corners[i]); 
+void Blending::findSeamInPair(int i, int j, Rect overlap, const vector<UMat>& images, const vector<Rect>& rois, vector<UMat>& masks) {
+	/*
+		Only the overlap (with a small gap around it, as in OpenCV's graph cut) is given to the seam finder,
+		the rest of the masks can not be changed by the seam of this pair.
+	*/
+	const int gap = 10;
+	Rect area(overlap.x - gap, overlap.y - gap, overlap.width + 2 * gap, overlap.height + 2 * gap);
+	Rect area_i = area & rois[i];
+	Rect area_j = area & rois[j];
+
+	vector<UMat> pair_images(2), pair_masks(2);
+	vector<Point> pair_corners(2);
+	pair_images[0] = images[i](area_i - rois[i].tl());
+	pair_images[1] = images[j](area_j - rois[j].tl());
+	masks[i](area_i - rois[i].tl()).copyTo(pair_masks[0]);
+	masks[j](area_j - rois[j].tl()).copyTo(pair_masks[1]);
+	pair_corners[0] = area_i.tl();
+	pair_corners[1] = area_j.tl();
+
+	Ptr<SeamFinder> seam_finder = createSeamFinder();
+	seam_finder->find(pair_images, pair_corners, pair_masks); //this estimates the seam of the pair and cuts the masks of the pair
+
+	// the cut masks are written back to the masks of the images.
+	UMat mask_i = masks[i](area_i - rois[i].tl());
+	UMat mask_j = masks[j](area_j - rois[j].tl());
+	pair_masks[0].copyTo(mask_i);
+	pair_masks[1].copyTo(mask_j);
+}
+
+double Blending::getSeamScale(const vector<Size>& sizes) {
+	if (seamMegapix <= 0.0)
+		return 1.0;
+
+	// the largest warped image gets about "seamMegapix" megapixels.
+	double max_area = 0.0;
+	for (int i = 0; i < sizes.size(); i++)
+		max_area = max(max_area, (double)sizes[i].area());
+	if (max_area <= 0.0)
+		return 1.0;
+	return min(1.0, sqrt(seamMegapix * 1e6 / max_area));
+}
+
+Ptr<SeamFinder> Blending::createSeamFinder() {
+	switch (seamFinderType) {
+	case(VORONOI_SEAM):
+		return makePtr<VoronoiSeamFinder>();
+	case(DP_SEAM):
+		return makePtr<DpSeamFinder>(DpSeamFinder::COLOR_GRAD);
+	default:
+		return makePtr<GraphCutSeamFinder>(GraphCutSeamFinderBase::COST_COLOR);
 	}
-
-
-	Mat result_mask;
-	blender->blend(result, result_mask); // Blending and storing the final panoramic image in "result".
-}
\ No newline at end of file
+}
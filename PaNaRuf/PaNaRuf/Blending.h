@@ -22,6 +22,10 @@
 #include "opencv2/stitching/warpers.hpp"
 #include "opencv2/stitching/detail/seam_finders.hpp"
 #include "opencv2/stitching/detail/motion_estimators.hpp"
+#include "SeamFinderType.h"
+#include "BandBlender.h"
+#include "OutputWriter.h"
+#include "RoiIndex.h"
 
 using namespace std;
 using namespace cv;
@@ -32,6 +36,16 @@ using namespace samples;
 class Blending {
 
 public:
+	// Algorithm used to find the seams.
+	SeamFinderType seamFinderType = GRAPH_CUT_SEAM;
+
+	/*
+		The seams are found on downscaled copies of the warped images (the largest one has about "seamMegapix" megapixels),
+		then the seam masks are upscaled back to the compose scale (the scale of the warped images).
+		The seams do not need the full resolution, and the cost of the seam finders grows faster than the number of pixels.
+		A value <= 0 finds the seams at full resolution.
+	*/
+	double seamMegapix = 0.1;
 
 	/*
 		This function finds seams among the warped images.
@@ -40,9 +54,42 @@ public:
 		Note: Thanks to OpenCV, we used its open-source  methods and used them in the function below
 			  and arranged for our software.
 	*/
-	void applyMultiBandBlending(vector<Mat> warped_masks, vector<Mat> warped_images,
-		vector<Point> corners, vector<Size> sizes, Mat& result
+	void applyMultiBandBlending(const vector<Mat>& warped_masks, const vector<Mat>& warped_images,
+		const vector<Point>& corners, const vector<Size>& sizes, Mat& result
+	);
+
+	/*
+		Same as above, but the panorama is written to "writer" band by band instead of being kept in memory.
+		Returns false if the panorama could not be written.
+	*/
+	bool applyMultiBandBlending(const vector<Mat>& warped_masks, const vector<Mat>& warped_images,
+		const vector<Point>& corners, const vector<Size>& sizes, OutputWriter& writer
 	);
+
+private:
+	/*
+		Finds the seams among the warped images and gives the mask of each image cut along the seams in "seam_masks".
+		The warped images and masks are not modified. The seams are found only in the overlaps of the images,
+		the pairs of images are processed in parallel.
+	*/
+	void findSeams(const vector<Mat>& warped_masks, const vector<Mat>& warped_images,
+		const vector<Point>& corners, const vector<Size>& sizes, vector<Mat>& seam_masks);
+
+	/*
+		Finds the seam between the images i and j in their overlap and cuts their masks along it.
+		* images, masks, rois -> seam scale images, masks and their areas.
+	*/
+	void findSeamInPair(int i, int j, Rect overlap, const vector<UMat>& images, const vector<Rect>& rois, vector<UMat>& masks);
+
+	/*
+		Returns the scale of the seam images with respect to the warped images.
+	*/
+	double getSeamScale(const vector<Size>& sizes);
+
+	/*
+		Creates the seam finder of "seamFinderType".
+	*/
+	Ptr<SeamFinder> createSeamFinder();
 };
 
 #endif
\ No newline at end of file
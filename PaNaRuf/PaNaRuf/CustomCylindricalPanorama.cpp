@@ -28,7 +28,8 @@ int CustomCylindricalPanorama::applyCustomCylindricalWarping(vector<String> imag
 	*/
 	input_output.StartPairwiseMatches();
 	vector<PairwiseMatches> pairs;
-	relationFinder.findRelationsAmongImages(images, pairs);
+	vector<int> indices; // original index of each remaining image (in "image_names" and in the image store).
+	relationFinder.findRelationsAmongImages(images, pairs, indices);
 
 
 	// Checking if there are enough images to apply panorama.  
@@ -97,229 +98,100 @@ int CustomCylindricalPanorama::applyCustomCylindricalWarping(vector<String> imag
 		Applying cylindrical warping operations here...
 	*/
 	input_output.StartApplyingCylindricalWarping();
-	Warping(images, cameraParams, warped_images, warped_masks, corners, sizes); 
+	imageWarper.warpMapper.mapsDirectory = options.mapsDirectory;
+	imageWarper.gainCompensator.type = options.exposure;
+	if (options.projection != NONE)
+		projection = options.projection;
+	utils.setComposeScale(options.composeMegapix);
+	if (!options.tiledOutput.empty() || options.feather) {
+		TiledRendering(image_names, indices, images, cameraParams);
+		return 0;
+	}
+	Warping(image_names, indices, images, cameraParams, warped_images, warped_masks, corners, sizes); 
 
 	// Starts finding seams among the warped cylindrical images and stitchs them using multi-band blending.
 	input_output.StartApplyingBlending();
-	Mat result;
-	blending.applyMultiBandBlending(warped_masks, warped_images, corners, sizes, result);
-
-	// Writes the output image.
-	input_output.prepareOutputImage(CYLINDRICAL, result);
+	blending.seamFinderType = options.seamFinder;
+	blending.seamMegapix = options.seamMegapix;
+	// the blended bands go to the output image, or straight to the "-dzi" tile pyramid.
+	PanoramaOutput output(CYLINDRICAL, options);
+	output.finish(blending.applyMultiBandBlending(warped_masks, warped_images, corners, sizes, output.getWriter()));
 	return 0;
 }
 
 
 
-void CustomCylindricalPanorama::Warping(vector<Mat> images, vector<CameraParameters> cameraParams, vector<Mat>& warped_images, vector<Mat>& warped_masks, vector<Point>& corners, vector<Size>& sizes) {
+void CustomCylindricalPanorama::Warping(vector<String> image_names, vector<int> indices, vector<Mat>& images, vector<CameraParameters> cameraParams, vector<Mat>& warped_images, vector<Mat>& warped_masks, vector<Point>& corners, vector<Size>& sizes) {
 
-	//Loop over each source image and apply the following.
+	/*
+		The exposure gains are estimated at the work scale, and the images are warped at the compose scale.
+		Each image is read again at the compose scale just before it is warped.
+	*/
+	vector<CameraParameters> composeParams = getComposeCameras(cameraParams);
+	vector<Mat> Ks(images.size()), composeKs(images.size()), Rs(images.size());
+	vector<Size> compose_sizes(images.size());
 	for (int i = 0; i < images.size(); i++) {
-
-		cout << "Warping " << (i + 1) << "/" << images.size() << endl;
-
-		/*
-			Creating border-reflect effect around the images
-			which we need for multi-band blending.
-		*/
-		Mat border_reflected_image;
-		utils.addReflectiveImagesAround(images[i], border_reflected_image);
-
-		// Applying forward warping for i-th image.
-		Rect roi = forwardWarping(images[i], cameraParams[i].getK(), cameraParams[i].getR()); //applies forward warping and finds size of the dst/warped image.
-		if (!roi.empty() && roi.area() == 0)
-			continue;
-		else
-			if (roi.empty())
-				continue;
-
-		/*
-			After finding the top-left corner point of each cylindrical image along with its size,
-			we keep track of each of those data which we need in applying multi-band blending.
-		*/
-		corners.push_back(roi.tl()); // top-left corner points of each cylindrical image.
-		sizes.push_back(roi.size()); // size of each cylindrical image.
-
-
-		Mat warped_image, warped_mask; // destination (cylindrical) image and destination mask
-		
-		/*
-			Apply backward mapping for i-th cylindrical image.
-		*/
-		BackwardWarping(border_reflected_image, roi, warped_image, warped_mask, cameraParams[i].getK(), cameraParams[i].getR());
-
-		// add each warped cylindrical images and corresponding masks to the vectors below.
-		warped_images.push_back(warped_image);
-		warped_masks.push_back(warped_mask);
-
-		// free all of the created matrices.
-		warped_image.release();
-		warped_mask.release();
-		border_reflected_image.release();
-
+		Ks[i] = cameraParams[i].getK();
+		composeKs[i] = composeParams[i].getK();
+		Rs[i] = cameraParams[i].getR();
+		compose_sizes[i] = utils.getComposeSize(indices[i]);
 	}
-}
+	imageWarper.estimateGains(projection, images, Ks, Rs);
 
-	
-Rect CustomCylindricalPanorama::forwardWarping(Mat image, Mat K, Mat R) {
-	int w = image.cols; // width of the source image
-	int h = image.rows; // height of the source image
-	Point2i topLeft = Point2i(INT_MAX, INT_MAX); // top-left point of the destination image
-	Point2i bottomRight = Point2i(INT_MIN, INT_MIN); // bottom-right of the destination image
+	// the registration images are not needed anymore.
+	images.clear();
 
-	/*
-		Instead of multiplying R^-1 by K^-1 at each iteration, we multiply it beforehand
-		to speed-up the program.
-	*/
-	Mat Rinv_Kinv = R.inv() * K.inv();
+	imageWarper.warp(projection, compose_sizes, composeKs, Rs, [&](int i) {
+		return loadComposeImage(image_names, indices[i]);
+	}, warped_images, warped_masks, corners, sizes);
 
-	/*
-		Walk over each source image points and apply the forward mapping to get
-		the destination (cylindrical) image points.
-	*/
-	for (int i = 0; i < w; i++) {
-		for (int j = 0; j < h; j++) {
-
-			//2D Image points.
-			Mat p2d = Mat(Size(1, 3), CV_64F);
-			p2d.at<double>(0, 0) = double(i);
-			p2d.at<double>(1, 0) = double(j);
-			p2d.at<double>(2, 0) = 1.0;
-
-			//2D-3D un-projection and rotation.
-			Mat point3d = Rinv_Kinv * p2d;
-
-			//scale value is sqrt (X^2 + Z^2)
-			double scale_to_cyl = sqrt(pow(point3d.at<double>(0, 0), 2) + pow(point3d.at<double>(2, 0), 2));
-
-			//3D to unit-cylinder coordinates.
-			Mat point3d_cyl = point3d / scale_to_cyl;
-
-			//Longitude and Latitude (OR theta and phi) values 
-			Mat cyl = Mat(Size(1, 3), CV_64F);
-			cyl.at<double>(0, 0) = atan2(point3d_cyl.at<double>(0, 0), point3d_cyl.at<double>(2, 0));
-			cyl.at<double>(1, 0) = point3d_cyl.at<double>(1, 0);
-			cyl.at<double>(2, 0) = 1.0;
-
-			//to 2D cylindrical image points.
-			Mat point2d = Mat(Size(1, 3), CV_64F);;
-			point2d.at<double>(0, 0) = K.at<double>(0, 0) * cyl.at<double>(0, 0);
-			point2d.at<double>(1, 0) = K.at<double>(1, 1) * cyl.at<double>(1, 0);
-
-			/*
-				The following operations are applied to get min and maximum destination image points,
-				where min is top-left and max is bottom-right.
-			*/
-			if (topLeft.x > (int)round(point2d.at<double>(0, 0)))
-				topLeft.x = (int)round(point2d.at<double>(0, 0));
-			if (topLeft.y > (int)round(point2d.at<double>(1, 0)))
-				topLeft.y = (int)round(point2d.at<double>(1, 0));
-			if (bottomRight.x < (int)round(point2d.at<double>(0, 0)))
-				bottomRight.x = (int)round(point2d.at<double>(0, 0));
-			if (bottomRight.y < (int)round(point2d.at<double>(1, 0)))
-				bottomRight.y = (int)round(point2d.at<double>(1, 0));
-		}
+	// the warping stage is done with the compose images.
+	utils.imageStore.release();
+}
 
+vector<CameraParameters> CustomCylindricalPanorama::getComposeCameras(vector<CameraParameters> cameraParams) {
+	double compose_work_aspect = utils.composeScale / utils.workScale;
+	vector<CameraParameters> composeParams(cameraParams.size());
+	for (int i = 0; i < cameraParams.size(); i++) {
+		Mat K = cameraParams[i].getK().clone();
+		K.rowRange(0, 2) *= compose_work_aspect; // fx, fy, cx, cy
+		composeParams[i] = CameraParameters(K, cameraParams[i].getR());
 	}
-
-	if (topLeft.x == INT_MAX || topLeft.y == INT_MAX || bottomRight.x == INT_MIN || bottomRight.y == INT_MIN)
-		return Rect(Point(0, 0), Point(0, 0));
-	return Rect(topLeft, bottomRight);
+	return composeParams;
 }
 
-void CustomCylindricalPanorama::BackwardWarping(Mat image, Rect roi, Mat& warped_image, Mat& warped_mask, Mat K, Mat R) {
-	int ws = image.cols; // width of source image.
-	int hs = image.rows; // height of source image.
-	int wd = roi.br().x - roi.tl().x; // width of destination (cylindrical) image.
-	int hd = roi.br().y - roi.tl().y; // height of destination (cylindrical) image.
-
-	cout << wd << "x" << hd << endl;
-
-	// offset is used to shift the cylindrical image point to actual point in x-y image coordinates. 
-	Point2d offset = 0.5 * Point2d((roi.tl() + roi.br())) - Point2d(double(wd) * 0.5, double(hd) * 0.5);
-
-	// warped_image is destination (cylindrical) image
-	warped_image = Mat(Size(wd, hd), CV_8UC3, Scalar(0));
-
-	// warped_mask is destination (cylindrical) mask
-	warped_mask = Mat(Size(wd, hd), CV_8U, Scalar(0));
-
-	/*
-		Instead of multiplying K by R at each step of iteration, we multiply them here.
-		(this improves the overall complexity of mapping operations)
-	*/
-	Mat KR = K * R;
-
-// we use omp to paralelize the pixelwise operations via multithreading  
-#pragma omp parallel for
-	for (int x = 0; x < wd; x++) {
-		for (int y = 0; y < hd; y++) {
-			// un-unproject from 2D cylindrical image coordinate to get theta and phi respectively.
-			Mat cyl = Mat(Size(1, 3), CV_64F);
-			cyl.at<double>(0, 0) = (x + offset.x) / K.at<double>(0, 0);
-			cyl.at<double>(1, 0) = (y + offset.y) / K.at<double>(1, 1);
-			cyl.at<double>(2, 0) = 1.0;
-
-			// Obtain unit-cylinder coordinates from theta and phi
-			Mat point3d = Mat(Size(1, 3), CV_64F);
-			point3d.at<double>(0, 0) = sin(cyl.at<double>(0, 0));
-			point3d.at<double>(1, 0) = cyl.at<double>(1, 0);
-			point3d.at<double>(2, 0) = cos(cyl.at<double>(0, 0));
-
-			// pass to 3D coordinates. We use fabs since cosine can also be negative.
-			point3d = point3d / fabs(point3d.at<double>(2, 0));
-
-			// Rotate in 3D and project to 2D source image coordinate.
-			Mat point2d = KR * point3d;
-
-			// If the point is beyond camera, do not take it.
-			if (point2d.at<double>(2, 0) <= 0)
-				continue;
-
-			// normalize to [x,y,1]
-			point2d = point2d / point2d.at<double>(2, 0);
-
-			// corresponding point
-			Point2d pixel = Point2d(point2d.at<double>(0, 0), point2d.at<double>(1, 0));
-
-			/* 
-				Since we added self-reflected images around the source image. We
-				need to shift the point from top left to middle.
-			*/
-			pixel.x += ((double)ws / 2.0 - (double)ws / 6.0);
-			pixel.y += ((double)hs / 2.0 - (double)hs / 6.0);
-
-			/* Below, we check if the requested pixel value is within the source image borders,
-				* If yes, we apply bilinear-interpolation method to color each pixel
-				  of destination (cylindrical) image. And, we give white color to mask.
-				* If no,  we ignore the current pixel value of destination (cylindrical) image and
-				  we give black color to mask.
-			*/
-			if (pixel.x > 1 && pixel.x < (double(ws) - 1.0) &&
-				pixel.y > 1 && pixel.y < (double(hs) - 1.0) &&
-				floor(pixel.x) != ceil(pixel.x) &&
-				floor(pixel.y) != ceil(pixel.y)) {
-
-				warped_image.at<Vec3b>(y, x) = utils.BilinearInterpolation(pixel.x, pixel.y, image);
-			}
-
-			else if (round(pixel.x) >= 0 && round(pixel.x) < ws &&
-				round(pixel.y) >= 0 && round(pixel.y) < hs) {
-
-				warped_image.at<Vec3b>(y, x) = image.at<Vec3b>((int)round(pixel.y), (int)round(pixel.x));
-			}
-
-
-			if (pixel.x > (double(ws) / 3.0) && pixel.x < ((double(ws) / 3.0) * 2.0 - 1.0) &&
-				pixel.y >(double(hs) / 3.0) && pixel.y < ((double(hs) / 3.0) * 2.0 - 1.0)) {
-
-				warped_mask.at<uchar>(y, x) = 255;
-			}
-			else {
-				warped_mask.at<uchar>(y, x) = 0;
-			}
-		}
-
+void CustomCylindricalPanorama::TiledRendering(vector<String> image_names, vector<int> indices, vector<Mat>& images, vector<CameraParameters> cameraParams) {
+	vector<CameraParameters> composeParams = getComposeCameras(cameraParams);
+	vector<Mat> Ks(indices.size()), composeKs(indices.size()), Rs(indices.size()), gainMaps(indices.size());
+	vector<Size> compose_sizes(indices.size());
+	for (int i = 0; i < indices.size(); i++) {
+		Ks[i] = cameraParams[i].getK();
+		composeKs[i] = composeParams[i].getK();
+		Rs[i] = cameraParams[i].getR();
+		compose_sizes[i] = utils.getComposeSize(indices[i]);
 	}
+	imageWarper.estimateGains(projection, images, Ks, Rs);
+	for (int i = 0; i < indices.size(); i++)
+		gainMaps[i] = imageWarper.gainCompensator.getGainMap(i);
+
+	// the registration images are not needed anymore, the renderer reads the images from the image store.
+	images.clear();
+
+	// "-tiled" and "-dzi" stream the panorama to files, "-feather" alone keeps it in memory and writes the usual output image.
+	PanoramaOutput output(CYLINDRICAL, options);
+	if (output.isInMemory())
+		input_output.StartFeatherCompositing();
+	output.finish(tiledRenderer.render(projection, compose_sizes, composeKs, Rs, gainMaps, [&](int i) {
+		return loadComposeImage(image_names, indices[i]);
+	}, output.getWriter()));
+	utils.imageStore.release();
 }
 
+Mat CustomCylindricalPanorama::loadComposeImage(vector<String>& image_names, int i) {
+	Mat image = utils.loadComposeImage(i);
+	if (image.empty()) {
+#pragma omp critical(output)
+		input_output.readingError(image_names[i]);
+	}
+	return image;
+}
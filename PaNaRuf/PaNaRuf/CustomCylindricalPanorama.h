@@ -10,6 +10,10 @@
 #include "Blending.h"
 #include "Utils.h"
 #include "CustomRelationFinder.h"
+#include "ImageWarper.h"
+#include "PanoramaOptions.h"
+#include "TiledRenderer.h"
+#include "PanoramaOutput.h"
 
 using namespace std;
 using namespace cv; 
@@ -40,6 +44,18 @@ public:
 	// Applies multi-band blending algorithm to smoothly stitch the images.
 	Blending blending;
 
+	// Estimates the exposure gains, finds the areas of the warped images and warps them.
+	ImageWarper imageWarper;
+
+	// Renders the panorama tile by tile when "-tiled" is given.
+	TiledRenderer tiledRenderer;
+
+	// Optional settings given by the user.
+	PanoramaOptions options;
+
+	// Projection of the panorama (cylindrical by default, it can be changed with the "-projection" option).
+	PanoramaType projection = CYLINDRICAL;
+
 	/*
 		Start of the algorithm here ...
 	*/
@@ -47,21 +63,29 @@ public:
 	
 	/*
 		Step by step warping operations are operated in this function.
+		The gains are estimated with the registration images, which are then released ("images" is cleared),
+		and the images are read again at the compose scale when they are warped.
+	*/
+	void Warping(vector<String> image_names, vector<int> indices, vector<Mat>& images, vector<CameraParameters> cameraParams, vector<Mat>& warped_images, vector<Mat>& warped_masks, vector<Point>& corners, vector<Size>& sizes);
+
+	/*
+		The cameras are estimated at the work scale of the images. At the compose scale, the focal lengths
+		and the principal point are multiplied by the ratio of the scales (the rotations do not change).
 	*/
-	void Warping(vector<Mat> images, vector<CameraParameters> cameraParams, vector<Mat>& warped_images, vector<Mat>& warped_masks, vector<Point>& corners, vector<Size>& sizes);
+	vector<CameraParameters> getComposeCameras(vector<CameraParameters> cameraParams);
 
 	/*
-		In this function , we apply forward warping operations to source image
-		and we get the size of the destination (cylindrical) image.
+		Renders the panorama tile by tile (instead of warping and blending the whole images)
+		and writes it to "options.tiledOutput" and/or "options.dziOutput", or to the output image in the feather mode ("-feather").
+		As in Warping, the gains are estimated with the registration images, which are then released.
 	*/
-	Rect forwardWarping(Mat image, Mat K, Mat R);	
+	void TiledRendering(vector<String> image_names, vector<int> indices, vector<Mat>& images, vector<CameraParameters> cameraParams);
 
 	/*
-		The function below applies backward mapping to each cylindrical image points,
-		finds the corresponding pixel value in the source image, and gives this pixel value
-		to the current pixel in cylindrical image using bilinear interpolation method.
+		Reads image i (original index in "image_names") at the compose scale from the image store.
+		A file which can not be read anymore is reported, and the image is left out of the panorama.
 	*/
-	void BackwardWarping(Mat image, Rect roi, Mat& warped_image, Mat& warped_mask, Mat K, Mat R);
+	Mat loadComposeImage(vector<String>& image_names, int i);
 };
 
 #endif 
\ No newline at end of file
@@ -10,6 +10,10 @@
 #include "Blending.h"
 #include "Utils.h"
 #include "CustomRelationFinder.h"
+#include "ImageWarper.h"
+#include "PanoramaOptions.h"
+#include "TiledRenderer.h"
+#include "PanoramaOutput.h"
 
 using namespace std;
 using namespace cv; 
@@ -39,6 +43,15 @@ public:
 	// Applies multi-band blending algorithm to smoothly stitch the images.
 	Blending blending;
 
+	// Estimates the exposure gains, finds the areas of the warped images and warps them.
+	ImageWarper imageWarper;
+
+	// Renders the panorama tile by tile when "-tiled" is given.
+	TiledRenderer tiledRenderer;
+
+	// Optional settings given by the user.
+	PanoramaOptions options;
+
 	/*
 		Start of the algorithm here ...
 	*/
@@ -46,21 +59,28 @@ public:
 	
 	/*
 		Step by step warping operations are operated in this function.
+		The gains are estimated with the registration images, which are then released ("images" is cleared),
+		and the images are read again at the compose scale when they are warped.
+	*/
+	void Warping(vector<String> image_names, vector<int> indices, vector<Mat>& images, vector<Mat> Hs, vector<Mat>& warped_images, vector<Mat>& warped_masks, vector<Point>& corners, vector<Size>& sizes);
+
+	/*
+		The homographies are found between the images at the work scale. At the compose scale S = diag(s, s, 1)
+		(s is the ratio of the scales), both sides are scaled : H' = S * H * S^-1.
 	*/
-	void Warping(vector<Mat> images, vector<Mat> Hs, vector<Mat>& warped_images, vector<Mat>& warped_masks, vector<Point>& corners, vector<Size>& sizes);
+	vector<Mat> getComposeHomographies(vector<Mat> Hs);
 
 	/*
-		In this function , we transform each source image via Homography matrix,
-		and we get the size of the destination warped image.
+		Renders the panorama tile by tile and writes it to the outputs of PanoramaOutput (or to the output image with "-feather").
+		As in Warping, the gains are estimated with the registration images, which are then released.
 	*/
-	Rect forwardWarping(Mat image, Mat H);	
+	void TiledRendering(vector<String> image_names, vector<int> indices, vector<Mat>& images, vector<Mat> Hs);
 
 	/*
-		The function below applies backward mapping to each warped (destination) image points,
-		finds the corresponding pixel value in the source image, and gives this pixel value
-		to the current pixel in warped (destination) image using bilinear interpolation method.
+		Reads image i (original index in "image_names") at the compose scale from the image store.
+		A file which can not be read anymore is reported, and the image is left out of the panorama.
 	*/
-	void BackwardWarping(Mat image, Rect roi, Mat& warped_image, Mat& warped_mask, Mat H);
+	Mat loadComposeImage(vector<String>& image_names, int i);
 };
 
 #endif 
\ No newline at end of file
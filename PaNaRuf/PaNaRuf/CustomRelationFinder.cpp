@@ -1,7 +1,7 @@
 #include <iostream>
 #include "CustomRelationFinder.h"
 #include <omp.h>
-void CustomRelationFinder  :: findRelationsAmongImageSets(vector<vector<Mat>>& rectImagesSet, vector<vector<CameraParameters>>& rectCamerasSet , vector<String> image_names) {
+void CustomRelationFinder  :: findRelationsAmongImageSets(vector<vector<Mat>>& rectImagesSet, vector<vector<CameraParameters>>& rectCamerasSet , vector<String> image_names, vector<int>& setIndices) {
 
     ComputeFeatures computeFeatures; // extracts features of an image
     vector<PairwiseMatches> all_pairs; // keeps track of all pairs of images.
@@ -116,10 +116,14 @@ void CustomRelationFinder  :: findRelationsAmongImageSets(vector<vector<Mat>>& r
     }
 
     // remove the image sets which do not have any relationship with any other image sets.
+    setIndices.clear();
+    for (int i = 0; i < flags.size(); i++)
+        setIndices.push_back(i);
     for (int i = 0; i < flags.size(); ) {
         if (!flags[i]) { //no relationship
             rectImagesSet.erase(rectImagesSet.begin() + i);
             rectCamerasSet.erase(rectCamerasSet.begin() + i);
+            setIndices.erase(setIndices.begin() + i);
             flags.erase(flags.begin() + i);
         }
         else i++;
@@ -131,11 +135,14 @@ void CustomRelationFinder  :: findRelationsAmongImageSets(vector<vector<Mat>>& r
     The following 2 functions are used as steps of cylindrical panorama.
 */
 
-void CustomRelationFinder::removeUnpairedImages(vector<Mat>& images, vector<PairwiseMatches>& pairs) {
+void CustomRelationFinder::removeUnpairedImages(vector<Mat>& images, vector<PairwiseMatches>& pairs, vector<int>& indices) {
     /*
         If there exist an image with no relation (overlapping) or weaker relation (bad homography), 
         we delete the image and its corresponding camera parameters from the lists (cameras, images, pairs).  
     */
+    indices.clear();
+    for (int i = 0; i < images.size(); i++)
+        indices.push_back(i);
     for (int i = 0; i < images.size();) {
         bool found = false;
         for (int j = 0; j < pairs.size(); j++) {
@@ -146,6 +153,7 @@ void CustomRelationFinder::removeUnpairedImages(vector<Mat>& images, vector<Pair
         }
         if (!found) {
             images.erase(images.begin() + i);
+            indices.erase(indices.begin() + i);
             for (int j = 0; j < pairs.size(); j++) {
                 if (pairs[j].getObj() > i)
                     pairs[j].setObj(pairs[j].getObj() - 1);
@@ -158,7 +166,7 @@ void CustomRelationFinder::removeUnpairedImages(vector<Mat>& images, vector<Pair
 }
 
 
-void CustomRelationFinder::findRelationsAmongImages(vector<Mat>& images, vector<PairwiseMatches>& pairs) {
+void CustomRelationFinder::findRelationsAmongImages(vector<Mat>& images, vector<PairwiseMatches>& pairs, vector<int>& indices) {
     
     ComputeFeatures computeFeatures; // extracts features of an image
     vector<PairwiseMatches> all_pairs; // keeps track of all pairs of images.
@@ -251,5 +259,5 @@ void CustomRelationFinder::findRelationsAmongImages(vector<Mat>& images, vector<
         Remove the images and its corresponding camera parameters, 
         if those images have "no" or "not good" overlap with any other images in the list.
     */
-    removeUnpairedImages(images, pairs);
+    removeUnpairedImages(images, pairs, indices);
 }
@@ -20,8 +20,9 @@ class CustomRelationFinder {
 public:
 	/*
 		Finds relationships among rectilinear image sets.
+		The sets having no relation are removed, "setIndices" gives the original index of each remaining set.
 	*/
-	void findRelationsAmongImageSets(vector<vector<Mat>>& rectImagesSet, vector<vector<CameraParameters>>& rectCamerasSet, vector<String> image_names);
+	void findRelationsAmongImageSets(vector<vector<Mat>>& rectImagesSet, vector<vector<CameraParameters>>& rectCamerasSet, vector<String> image_names, vector<int>& setIndices);
 	
 	/*
 		* Extracts features of each images.
@@ -29,12 +30,14 @@ public:
 		* Estimates homographies using those matching points.
 		* Keeps only the images creating panoramic network.
 		* Removes the other images which has no relation or weak relation.
+		  "indices" gives the original index of each remaining image.
 	*/
-	void findRelationsAmongImages(vector<Mat>& images, vector<PairwiseMatches>& pairs);
+	void findRelationsAmongImages(vector<Mat>& images, vector<PairwiseMatches>& pairs, vector<int>& indices);
 	/*
 		Removes an image if it has weaker relation with any other image, or if it has no relation with any of the images.
+		The original index of each remaining image is kept in "indices".
 	*/
-	void removeUnpairedImages(vector<Mat>& images, vector<PairwiseMatches>& pairs);
+	void removeUnpairedImages(vector<Mat>& images, vector<PairwiseMatches>& pairs, vector<int>& indices);
 	
 };
 #endif
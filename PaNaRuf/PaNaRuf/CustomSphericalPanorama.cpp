@@ -1,5 +1,6 @@
 #include "CustomSphericalPanorama.h"
 #include "CustomRelationFinder.h"
+#include <climits>
 
 int  CustomSphericalPanorama::applyCustomSphericalWarping(vector<String> image_names, double hfov, double vfov) {
     
@@ -22,9 +23,20 @@ int  CustomSphericalPanorama::applyCustomSphericalWarping(vector<String> image_n
         Deriving multiple rectilinear images and storing in rectImagesSet.
         Deriving multiple corresponding pinhole camera parameters and storing in rectCamerasSet.
     */
+    /*
+        The fisheye images are not kept, only their small rectilinear images. In the direct mode,
+        they are read again from the image store when they are warped.
+    */
+    vector<Size> fisheyeSizes;
+    utils.imageStore.open(image_names);
+
     input_output.StartGettingRectilinearImages(); // printer
+
+    // the next fisheye images are decoded in the background while the rectilinear images of the current one are derived.
+    ImageLoader loader;
+    loader.start(image_names);
     for (int i = 0; i < image_names.size(); i++) {
-        Mat image = imread(image_names[i]);
+        Mat image = loader.get(i);
         if (image.empty()) {
             input_output.readingError(image_names[i]);
             return -1;
@@ -44,6 +56,7 @@ int  CustomSphericalPanorama::applyCustomSphericalWarping(vector<String> image_n
         */
         rectImagesSet.push_back(subImages);
         rectCamerasSet.push_back(subCameras);
+        fisheyeSizes.push_back(image.size());
         
         // free unnecessary matrix and clear the vectors.
         image.release();
@@ -60,7 +73,16 @@ int  CustomSphericalPanorama::applyCustomSphericalWarping(vector<String> image_n
         derived from different fisheye images.
     */
     input_output.StartFindingRelations(); //printer
-    relationFinder.findRelationsAmongImageSets(rectImagesSet, rectCamerasSet, image_names);
+    if (rectCamerasSet.empty() || rectCamerasSet[0].empty())
+        return -1;
+    /*
+        The virtual camera rotations are the same for all sets (see findCameraParameters),
+        the relation finder multiplies them by the relative rotation of the set.
+    */
+    Mat R_virtual = rectCamerasSet[0][0].getR().clone();
+    Mat K = rectCamerasSet[0][0].getK().clone();
+    vector<int> setIndices;
+    relationFinder.findRelationsAmongImageSets(rectImagesSet, rectCamerasSet, image_names, setIndices);
 
     /*
         - warped_images : stores each spherical image
@@ -74,15 +96,42 @@ int  CustomSphericalPanorama::applyCustomSphericalWarping(vector<String> image_n
     vector<Size> sizes;
 
     input_output.StartApplyingSphericalWarping();
-    Warping(rectImagesSet, rectCamerasSet, warped_images, warped_masks, corners, sizes);
+    imageWarper.warpMapper.mapsDirectory = options.mapsDirectory;
+    imageWarper.gainCompensator.type = options.exposure;
+    if (options.projection != NONE)
+        projection = options.projection;
+    // except in the direct mode, only the rectilinear images are used from now on.
+    if (!options.directFisheye)
+        utils.imageStore.release();
+    if (!options.tiledOutput.empty() || options.feather) {
+        TiledRendering(rectImagesSet, rectCamerasSet);
+        return 0;
+    }
+    if (options.directFisheye) {
+        /*
+            Rotation of each remaining fisheye image:
+            R_final = R_virtual * R_fish  ->  R_fish = R_virtual^-1 * R_final
+        */
+        vector<Mat> fisheyeRotations;
+        for (int i = 0; i < setIndices.size(); i++)
+            fisheyeRotations.push_back(R_virtual.inv() * rectCamerasSet[i][0].getR());
+        // the rectilinear images are not needed anymore.
+        rectImagesSet.clear();
+        DirectWarping(image_names, setIndices, fisheyeSizes, fisheyeRotations, K, warped_images, warped_masks, corners, sizes);
+    }
+    else
+        Warping(rectImagesSet, rectCamerasSet, warped_images, warped_masks, corners, sizes);
+
+    // the warping stage is done with the fisheye images (direct mode).
+    utils.imageStore.release();
 
     // Starts blending the warped images using multi-band blending algorithm of OPENCV.
     input_output.StartApplyingBlending();
-    Mat result;
-    blending.applyMultiBandBlending(warped_masks, warped_images, corners, sizes, result);
-
-    // Writes the output image.
-    input_output.prepareOutputImage(SPHERICAL, result);
+    blending.seamFinderType = options.seamFinder;
+    blending.seamMegapix = options.seamMegapix;
+    // the blended bands go to the output image, or straight to the "-dzi" tile pyramid.
+    PanoramaOutput output(SPHERICAL, options);
+    output.finish(blending.applyMultiBandBlending(warped_masks, warped_images, corners, sizes, output.getWriter()));
     return 0;
 }
 
@@ -209,301 +258,316 @@ void CustomSphericalPanorama::findCameraParameters(vector<CameraParameters>& cam
 
 void CustomSphericalPanorama::fish2persp(Mat& image, vector<Mat>& images, vector<CameraParameters>& cameraParams) {
     
-
-    int ws = image.cols; // width of fisheye image.
-    int hs = image.rows; // height of fisheye image.
-    double N = min(ws, hs); // minimum dimension
-
     int wd = 300; // by default the width of each rectilinear image is to 300
     int hd = 300; // by default the height of each rectilinear image is to 300
 
     int numberOfImages = 0; // the number of rectilinear image is initialized
 
-    double F = double(N) * 0.5 / toRadian(hfov/2); //focal length of fisheye lens
-    
     //the function gets camera parameters of each rectilinear image.
     findCameraParameters(cameraParams, images, numberOfImages, wd, hd);
-    
-    // Mapping from fisheye image points to each reactilinear image points to color each rectilinear image.
-    for (int k = 0; k < numberOfImages; k++) {
-        Mat Rinv_Kinv = cameraParams[k].getR().inv() * cameraParams[k].getK().inv();
+
+    // The mapping from fisheye image points to rectilinear image points is the same for all fisheye images of this size.
+    const vector<WarpMap>& maps = getFisheyeMaps(image.size(), cameraParams, wd, hd);
+
+    /*
+        Each rectilinear image is colored by resampling the fisheye image with its remap table.
+        The rows of all rectilinear images are distributed among the threads.
+    */
 #pragma omp parallel for
-        for (int i = 0; i < wd; i++) {
-            for (int j = 0; j < hd; j++) {
-                // 2D rectilinear image
-                Mat p2d = Mat(Size(1, 3), CV_64F);
-                p2d.at<double>(0, 0) = double(i);
-                p2d.at<double>(1, 0) = double(j);
-                p2d.at<double>(2, 0) = 1.0;
-
-                // to 3D
-                Mat p3d = Rinv_Kinv * p2d;
-                double r = sqrt(pow(p3d.at<double>(0, 0), 2) + pow(p3d.at<double>(1, 0), 2) + pow(p3d.at<double>(2, 0), 2));
-                
-                //to scene 
-                double theta = acos(p3d.at<double>(2, 0) / r);
-                double phi = atan2(p3d.at<double>(1, 0), p3d.at<double>(0, 0));
-                
-                // to 2D fisheye image 
-                double ru = F * theta;
-                double x_fish = 0.5 * double(ws) + ru * cos(phi);
-                double y_fish = 0.5 * double(hs) + ru * sin(phi);
-
-
-                /*
-                    Bilinear interpolation method is used to color each rectilinear image point 
-                    with the corresponding pixel value of (x_fish, y_fish) in fisheye iamge.
-                */
-                if (x_fish >= 1.0 && x_fish <= (ws - 1.0) &&
-                    y_fish >= 1.0 && y_fish <= (hs - 1.0)) {
-                    
-                    if (floor(x_fish) != ceil(x_fish) &&
-                        floor(y_fish) != ceil(y_fish)) {
-                        images[k].at<Vec3b>(j, i) = utils.BilinearInterpolation(x_fish, y_fish, image);
-                    }
-                    else {
-                        images[k].at<Vec3b>(j, i) = image.at<Vec3b>((int)round(y_fish), (int)round(x_fish));
-                    }
-                }
-                else {
-                    if (round(x_fish) >= 0.0 && round(x_fish) < 1.0 &&
-                        round(y_fish) >= 0.0 && round(y_fish) < 1.0) {
-                        images[k].at<Vec3b>(j, i) = image.at<Vec3b>((int)round(y_fish), (int)round(x_fish));
-                    }
-                }
-            }
-        }
+    for (int t = 0; t < numberOfImages * hd; t++) {
+        int k = t / hd; // rectilinear image
+        int j = t % hd; // row
+        sampler.sampleBatchFixed(image, maps[k].map_xy.ptr<short>(j), maps[k].map_frac.ptr<ushort>(j), wd, images[k].ptr<uchar>(j));
     }
 }
 
+const vector<WarpMap>& CustomSphericalPanorama::getFisheyeMaps(Size fisheyeSize, vector<CameraParameters>& cameraParams, int wd, int hd) {
+    string key = to_string(fisheyeSize.width) + "x" + to_string(fisheyeSize.height) + "_" + to_string(hfov) + "_" + to_string(vfov);
+
+    map<string, vector<WarpMap>>::iterator it = fisheyeMaps.find(key);
+    if (it != fisheyeMaps.end())
+        return it->second;
+
+    vector<WarpMap>& maps = fisheyeMaps[key];
+    maps.resize(cameraParams.size());
+    for (int k = 0; k < cameraParams.size(); k++) {
+        string file_name;
+        if (!options.mapsDirectory.empty())
+            file_name = options.mapsDirectory + "/fisheye_" + key + "_" + to_string(k) + ".yml.gz";
+
+        // the tables of the same lens may be computed in one of the previous runs.
+        if (!file_name.empty() && maps[k].load(file_name) && maps[k].isFixedPoint() &&
+            maps[k].sourceSize == fisheyeSize && maps[k].roi == Rect(0, 0, wd, hd))
+            continue;
+
+        buildFisheyeMap(fisheyeSize, cameraParams[k], wd, hd, maps[k]);
+        maps[k].convertToFixedPoint();
+        if (!file_name.empty())
+            maps[k].save(file_name);
+    }
+    return maps;
+}
 
-void CustomSphericalPanorama::Warping(vector<vector<Mat>> images, vector<vector<CameraParameters>> cameraParams, vector<Mat>& warped_images, vector<Mat>& warped_masks, vector<Point>& corners, vector<Size>& sizes) {
-   /*
-        Counting the number of rectilinear images in all.
-   */
-    int count = 0;
-    int counter = 0;
-    for (int i = 0; i < images.size(); i++) {
-        for (int j = 0; j < images[i].size(); j++) {
-            count++;
-        }
+Mat CustomSphericalPanorama::loadFisheyeImage(vector<String>& image_names, int i) {
+    Size original_size;
+    Mat image = utils.imageStore.get(i, 1.0, original_size);
+    if (image.empty()) {
+#pragma omp critical(output)
+        input_output.readingError(image_names[i]);
     }
+    return image;
+}
 
-    //Loop over each rectilinear image and apply the following.
-    for (int i = 0; i < images.size(); i++) {
-        for (int j = 0; j < images[i].size(); j++) {
+void CustomSphericalPanorama::buildFisheyeMap(Size fisheyeSize, CameraParameters camera, int wd, int hd, WarpMap& warpMap) {
+    int ws = fisheyeSize.width; // width of fisheye image.
+    int hs = fisheyeSize.height; // height of fisheye image.
+    double N = min(ws, hs); // minimum dimension
+
+    double F = double(N) * 0.5 / toRadian(hfov/2); //focal length of fisheye lens
+
+    warpMap.roi = Rect(0, 0, wd, hd);
+    warpMap.sourceSize = fisheyeSize;
+    warpMap.map_x = Mat(hd, wd, CV_32F);
+    warpMap.map_y = Mat(hd, wd, CV_32F);
+    warpMap.mask = Mat(hd, wd, CV_8U);
+
+    Mat Rinv_Kinv_mat = camera.getR().inv() * camera.getK().inv();
+    const double* Rinv_Kinv = Rinv_Kinv_mat.ptr<double>(0);
+    // rows are in the outer loop, since the images are stored row by row.
+#pragma omp parallel for
+    for (int j = 0; j < hd; j++) {
+        // fisheye image points of the current row.
+        float* xs_fish = warpMap.map_x.ptr<float>(j);
+        float* ys_fish = warpMap.map_y.ptr<float>(j);
+        uchar* mask = warpMap.mask.ptr<uchar>(j);
+
+        // 2D rectilinear image to 3D
+        vector<float> X(wd), Y(wd), Z(wd), rho(wd), theta(wd);
+        for (int i = 0; i < wd; i++) {
+            X[i] = (float)(Rinv_Kinv[0] * i + Rinv_Kinv[1] * j + Rinv_Kinv[2]);
+            Y[i] = (float)(Rinv_Kinv[3] * i + Rinv_Kinv[4] * j + Rinv_Kinv[5]);
+            Z[i] = (float)(Rinv_Kinv[6] * i + Rinv_Kinv[7] * j + Rinv_Kinv[8]);
+            rho[i] = X[i] * X[i] + Y[i] * Y[i];
+        }
+
+        /*
+            to scene : theta = acos(Z / r) = atan2(rho, Z), where rho = sqrt(X^2 + Y^2),
+            and cos(phi), sin(phi) are simply X / rho and Y / rho.
+        */
+        FastMath::sqrt(rho.data(), rho.data(), wd);
+        FastMath::atan2(rho.data(), Z.data(), theta.data(), wd);
 
-            cout << "Warping " << ++counter << "/" << count << endl;
-
-            /*
-                Creating border-reflect effect around the rectilinear image
-                which we need for multi-band blending.
-            */
-            Mat border_reflected_image;
-            utils.addReflectiveImagesAround(images[i][j], border_reflected_image);
-
-            // Applying forward warping for ij-th rectilinear image.
-            Rect roi = forwardWarping(images[i][j], cameraParams[i][j].getK(), cameraParams[i][j].getR()); //applies forward warping and finds size of the dst/warped image.
-            if (!roi.empty() && roi.area() == 0)
-                continue;
-            else
-                if (roi.empty())
-                    continue;
-
-            /*
-                After finding the top-left corner point of each spherical image along with its size,
-                we keep track of each of those data which we need in applying multi-band blending.
-            */
-            corners.push_back(roi.tl()); // top-left corner points of each spherical image.
-            sizes.push_back(roi.size()); // size of each spherical image.
-
-            Mat warped_image, warped_mask; // destination (spherical) image and destination mask
-            
-            /*
-                Apply backward mapping for ij-th spherical image.
-            */
-            BackwardWarping(border_reflected_image, roi, warped_image, warped_mask, cameraParams[i][j].getK(), cameraParams[i][j].getR());
-            
-            // add each warped spherical images and corresponding masks to the vectors below.
-            warped_images.push_back(warped_image);
-            warped_masks.push_back(warped_mask);
-
-            // free all of the created matrices.
-            warped_image.release();
-            warped_mask.release();
-            border_reflected_image.release();
+        for (int i = 0; i < wd; i++) {
+            // to 2D fisheye image 
+            float ru = (float)F * theta[i];
+            float c = (rho[i] > 0) ? X[i] / rho[i] : 1.0f;
+            float s = (rho[i] > 0) ? Y[i] / rho[i] : 0.0f;
+            xs_fish[i] = 0.5f * ws + ru * c;
+            ys_fish[i] = 0.5f * hs + ru * s;
+            mask[i] = (xs_fish[i] >= 0 && xs_fish[i] <= ws - 1 && ys_fish[i] >= 0 && ys_fish[i] <= hs - 1) ? 255 : 0;
         }
     }
 }
 
-Rect CustomSphericalPanorama::forwardWarping(Mat image, Mat K, Mat R) {
-    int w = image.cols; // width of the rectilinear image
-    int h = image.rows; // height of the rectilinear image
-    Point2i topLeft = Point2i(INT_MAX, INT_MAX); // top-left point of the spherical image
-    Point2i bottomRight = Point2i(INT_MIN, INT_MIN); // bottom-right of the spherical image
+Rect CustomSphericalPanorama::findFisheyeRoi(Mat K, Mat R_fish) {
+    double fx = K.at<double>(0, 0);
+    double fy = K.at<double>(1, 1);
+    double maxTheta = toRadian(hfov / 2); // the largest angle between the optical axis and a ray seen by the fisheye lens
+    const double* R = R_fish.ptr<double>(0);
 
-    /*
-        Instead of multiplying R^-1 by K^-1 at each iteration, we multiply it beforehand
-        to speed-up the program.
-    */
-    Mat Rinv_Kinv = R.inv() * K.inv();
+    // the whole sphere : theta in [-pi, pi], phi in [-pi/2, pi/2]
+    int x_begin = cvFloor(-CV_PI * fx), x_end = cvCeil(CV_PI * fx);
+    int y_begin = cvFloor(-CV_PI * 0.5 * fy), y_end = cvCeil(CV_PI * 0.5 * fy);
 
     /*
-        Walk over each rectilinear image points and apply the forward mapping to get
-        the destination (spherical) image points.
+        The field of view is a smooth region on the sphere, so checking every "step"-th point
+        and enlarging the found area by "step" is enough.
     */
-    
-    //definition of lock which handles critical section problem for multi-threading
-    omp_lock_t writelock;
-    omp_init_lock(&writelock);
-#pragma omp parallel for 
-    for (int i = 0; i < w; i++) {
-        for (int j = 0; j < h; j++) {
-
-            //2D Rectilinear Image points.
-            Mat p2d = Mat(Size(1, 3), CV_64F);
-            p2d.at<double>(0, 0) = double(i);
-            p2d.at<double>(1, 0) = double(j);
-            p2d.at<double>(2, 0) = 1.0;
-
-            //2D-3D un-projection and rotation.
-            Mat point3d = Rinv_Kinv * p2d;
-
-            //scale value is sqrt (X^2 + Y^2 + Z^2)
-            double scale_to_sph = sqrt(pow(point3d.at<double>(0, 0), 2) + pow(point3d.at<double>(1, 0), 2) + pow(point3d.at<double>(2, 0), 2));
-
-            //3D to unit-sphere coordinates.
-            Mat point3d_sph = point3d / scale_to_sph;
-
-            //Longitude and Latitude (OR theta and phi) values 
-            Mat sph = Mat(Size(1, 3), CV_64F);
-            sph.at<double>(0, 0) = atan2(point3d_sph.at<double>(0, 0), point3d_sph.at<double>(2, 0));
-            sph.at<double>(1, 0) = atan2(point3d_sph.at<double>(1, 0), sqrt(pow(point3d_sph.at<double>(0, 0), 2) + pow(point3d_sph.at<double>(2, 0), 2)));
-            sph.at<double>(2, 0) = 1.0;
-
-            //to 2D spherical image points.
-            double x_dst = K.at<double>(0, 0) * sph.at<double>(0, 0);
-            double y_dst = K.at<double>(1, 1) * sph.at<double>(1, 0);
-
-            /*
-                The following operations are applied to get minimum and maximum of spherical image points,
-                where min is top-left and max is bottom-right.
-            */
-            //only one thread can process the following at a time.
-            omp_set_lock(&writelock);
-                if (topLeft.x > (int)round(x_dst))
-                    topLeft.x = (int)round(x_dst);
-                if (topLeft.y > (int)round(y_dst))
-                    topLeft.y = (int)round(y_dst);
-                if (bottomRight.x < (int)round(x_dst))
-                    bottomRight.x = (int)round(x_dst);
-                if (bottomRight.y < (int)round(y_dst))
-                    bottomRight.y = (int)round(y_dst);
-            omp_unset_lock(&writelock);
+    const int step = 4;
+    int min_x = INT_MAX, min_y = INT_MAX, max_x = INT_MIN, max_y = INT_MIN;
+    for (int y = y_begin; y <= y_end; y += step) {
+        double phi = y / fy;
+        for (int x = x_begin; x <= x_end; x += step) {
+            double theta = x / fx;
+            double px = sin(theta) * cos(phi), py = sin(phi), pz = cos(theta) * cos(phi);
+            double X = R[0] * px + R[1] * py + R[2] * pz;
+            double Y = R[3] * px + R[4] * py + R[5] * pz;
+            double Z = R[6] * px + R[7] * py + R[8] * pz;
+            if (atan2(sqrt(X * X + Y * Y), Z) <= maxTheta) {
+                min_x = min(min_x, x); max_x = max(max_x, x);
+                min_y = min(min_y, y); max_y = max(max_y, y);
+            }
         }
     }
+    if (min_x > max_x)
+        return Rect();
 
-    if (topLeft.x == INT_MAX || topLeft.y == INT_MAX || bottomRight.x == INT_MIN || bottomRight.y == INT_MIN)
-        return Rect(Point(0, 0), Point(0, 0));
-    return Rect(topLeft, bottomRight);
+    Point tl(max(x_begin, min_x - step), max(y_begin, min_y - step));
+    Point br(min(x_end, max_x + step) + 1, min(y_end, max_y + step) + 1);
+    return Rect(tl, br);
 }
 
+void CustomSphericalPanorama::fish2sphere(Mat& image, Rect roi, Mat K, Mat R_fish, Mat& warped_image, Mat& warped_mask) {
+    int ws = image.cols; // width of fisheye image.
+    int hs = image.rows; // height of fisheye image.
+    double N = min(ws, hs); // minimum dimension
 
-void CustomSphericalPanorama::BackwardWarping(Mat image, Rect roi, Mat& warped_image, Mat& warped_mask, Mat K, Mat R) {
-    int ws = image.cols; // width of rectilinear image.
-    int hs = image.rows; // height of rectilinear image.
-    int wd = roi.br().x - roi.tl().x; // width of destination (spherical) image.
-    int hd = roi.br().y - roi.tl().y; // height of destination (spherical) image.
+    int wd = roi.width; // width of destination (spherical) image.
+    int hd = roi.height; // height of destination (spherical) image.
 
-    cout << wd << "x" << hd << endl;
+    double F = double(N) * 0.5 / toRadian(hfov / 2); //focal length of fisheye lens
+    double maxTheta = toRadian(hfov / 2);
 
-    // offset is used to shift the spherical image point to actual point in x-y image coordinates. 
-    Point2d offset = 0.5 * Point2d((roi.tl() + roi.br())) - Point2d(double(wd) * 0.5, double(hd) * 0.5);
+    /*
+        The points beyond the field of view are not in the mask, but they are colored with the pixels
+        at the border of the fisheye circle instead of black, which we need for multi-band blending.
+    */
+    double maxRadius = N * 0.5 - 1.0;
 
-    // warped_image is destination (spherical) image
-    warped_image = Mat(Size(wd, hd), CV_8UC3, Scalar(0));
+    double fx = K.at<double>(0, 0);
+    double fy = K.at<double>(1, 1);
+    const double* R = R_fish.ptr<double>(0);
 
-    // warped_mask is destination (spherical) mask
-    warped_mask = Mat(Size(wd, hd), CV_8U, Scalar(0));
+    warped_image.create(roi.size(), CV_8UC3);
+    warped_mask.create(roi.size(), CV_8U);
 
-    /*
-        Instead of multiplying K by R at each step of iteration, we multiply them here.
-        (this improves the overall complexity of mapping operations)
-    */
-    Mat KR = K * R;
+    // theta only depends on the column.
+    vector<float> longitude(wd), sin_theta(wd), cos_theta(wd);
+    for (int x = 0; x < wd; x++) {
+        longitude[x] = (float)((x + roi.x) / fx);
+    }
+    FastMath::sinCos(longitude.data(), sin_theta.data(), cos_theta.data(), wd);
 
-    // we use omp to paralelize the pixelwise operations via multithreading  
 #pragma omp parallel for
-    for (int x = 0; x < wd; x++) {
-        for (int y = 0; y < hd; y++) {
-
-            // un-unproject from 2D spherical image coordinate to get theta and phi respectively.
-            Mat sph = Mat(Size(1, 3), CV_64F);
-            sph.at<double>(0, 0) = (x + offset.x) / K.at<double>(0, 0);
-            sph.at<double>(1, 0) = (y + offset.y) / K.at<double>(1, 1);
-            sph.at<double>(2, 0) = 1.0;
-
-            // Obtain unit-sphere coordinates from theta and phi
-            Mat point3d = Mat(Size(1, 3), CV_64F);
-            point3d.at<double>(0, 0) = sin(sph.at<double>(0, 0)) * cos(sph.at<double>(1, 0));
-            point3d.at<double>(1, 0) = sin(sph.at<double>(1, 0));
-            point3d.at<double>(2, 0) = cos(sph.at<double>(0, 0)) * cos(sph.at<double>(1, 0));
-
-            // pass to 3D coordinates. We use fabs since z-value can also be negative.
-            point3d = point3d / fabs(point3d.at<double>(2, 0));
-
-            // Rotate in 3D and project to 2D rectilinear image coordinate.
-            Mat point2d = KR * point3d;
-
-            // If the point is beyond camera, do not take it.
-            if (point2d.at<double>(2, 0) <= 0)
-                continue;
-
-            // normalize to [x,y,1]
-            point2d = point2d / point2d.at<double>(2, 0);
-
-            // corresponding point
-            Point2d pixel = Point2d(point2d.at<double>(0, 0), point2d.at<double>(1, 0));
-
-            /*
-                Since we added self-reflected images around the rectilinear image. We
-                need to shift the point from top left to middle.
-            */
-            pixel.x += ((double)ws / 2.0 - (double)ws / 6.0);
-            pixel.y += ((double)hs / 2.0 - (double)hs / 6.0);
-
-            /* Below, we check if the requested pixel value is within the rectilinear image borders,
-                * If yes, we apply bilinear-interpolation method to color each pixel
-                  of destination (spherical) image. And, we give white color to mask.
-                * If no,  we ignore the current pixel value of destination (spherical) image and
-                  we give black color to mask.
-            */
-            if (pixel.x > 1 && pixel.x < (double(ws) - 1.0) &&
-                pixel.y > 1 && pixel.y < (double(hs) - 1.0) &&
-                floor(pixel.x) != ceil(pixel.x) &&
-                floor(pixel.y) != ceil(pixel.y)) {
-
-                warped_image.at<Vec3b>(y, x) = utils.BilinearInterpolation(pixel.x, pixel.y, image);
-            }
+    for (int y = 0; y < hd; y++) {
+        // phi only depends on the row.
+        double phi = (y + roi.y) / fy;
+        double sin_phi = sin(phi);
+        double cos_phi = cos(phi);
+
+        // fisheye image points of the current row.
+        vector<float> xs_fish(wd), ys_fish(wd);
+        vector<float> X(wd), Y(wd), Z(wd), rho(wd), theta(wd);
+        uchar* mask = warped_mask.ptr<uchar>(y);
+
+        // spherical image point to 3D, then rotated to the fisheye camera.
+        for (int x = 0; x < wd; x++) {
+            double px = sin_theta[x] * cos_phi, py = sin_phi, pz = cos_theta[x] * cos_phi;
+            X[x] = (float)(R[0] * px + R[1] * py + R[2] * pz);
+            Y[x] = (float)(R[3] * px + R[4] * py + R[5] * pz);
+            Z[x] = (float)(R[6] * px + R[7] * py + R[8] * pz);
+            rho[x] = X[x] * X[x] + Y[x] * Y[x];
+        }
 
-            else if (round(pixel.x) >= 0 && round(pixel.x) < ws &&
-                round(pixel.y) >= 0 && round(pixel.y) < hs) {
+        /*
+            to 2D fisheye image : ru = F * theta, where theta = atan2(rho, Z) is the angle from the optical axis.
+            cos(phi) and sin(phi) of the fisheye model are X / rho and Y / rho.
+        */
+        FastMath::sqrt(rho.data(), rho.data(), wd);
+        FastMath::atan2(rho.data(), Z.data(), theta.data(), wd);
 
-                warped_image.at<Vec3b>(y, x) = image.at<Vec3b>((int)round(pixel.y), (int)round(pixel.x));
-            }
+        for (int x = 0; x < wd; x++) {
+            mask[x] = (theta[x] <= maxTheta) ? 255 : 0;
 
+            double ru = min(F * theta[x], maxRadius);
+            double c = (rho[x] > 0) ? X[x] / rho[x] : 1.0;
+            double s = (rho[x] > 0) ? Y[x] / rho[x] : 0.0;
+            xs_fish[x] = (float)(0.5 * double(ws) + ru * c);
+            ys_fish[x] = (float)(0.5 * double(hs) + ru * s);
+        }
 
-            if (pixel.x > (double(ws) / 3.0) && pixel.x < ((double(ws) / 3.0) * 2.0 - 1.0) &&
-                pixel.y >(double(hs) / 3.0) && pixel.y < ((double(hs) / 3.0) * 2.0 - 1.0)) {
+        sampler.sampleBatch(image, xs_fish.data(), ys_fish.data(), wd, warped_image.ptr<uchar>(y));
+    }
+}
 
-                warped_mask.at<uchar>(y, x) = 255;
-            }
-            else {
-                warped_mask.at<uchar>(y, x) = 0;
-            }
-        }
+void CustomSphericalPanorama::DirectWarping(vector<String> image_names, vector<int> fisheyeIndices, vector<Size> fisheyeSizes, vector<Mat> fisheyeRotations, Mat K, vector<Mat>& warped_images, vector<Mat>& warped_masks, vector<Point>& corners, vector<Size>& sizes) {
+    int count = (int)fisheyeIndices.size();
+
+    // the fisheye image is decoded while it is warped, it is also counted in the memory of the scheduler.
+    vector<Rect> rois(count);
+    vector<size_t> source_bytes(count);
+    for (int i = 0; i < count; i++) {
+        rois[i] = findFisheyeRoi(K, fisheyeRotations[i]);
+        source_bytes[i] = size_t(fisheyeSizes[fisheyeIndices[i]].area()) * 3;
+    }
+
+    // The spherical images of the fisheye images are large, so the scheduler warps them one by one (rows in parallel).
+    vector<Mat> all_warped_images(count), all_warped_masks(count);
+    int counter = 0;
+    imageWarper.warpScheduler.run(rois, source_bytes, [&](int i) {
+#pragma omp critical(output)
+        cout << "Warping " << ++counter << "/" << count << " (" << rois[i].width << "x" << rois[i].height << ")" << endl;
+
+        Mat image = loadFisheyeImage(image_names, fisheyeIndices[i]);
+        if (!image.empty())
+            fish2sphere(image, rois[i], K, fisheyeRotations[i], all_warped_images[i], all_warped_masks[i]);
+    });
+
+    for (int i = 0; i < count; i++) {
+        if (rois[i].empty() || all_warped_images[i].empty())
+            continue;
+        corners.push_back(rois[i].tl()); // top-left corner points of each spherical image.
+        sizes.push_back(rois[i].size()); // size of each spherical image.
+        warped_images.push_back(all_warped_images[i]);
+        warped_masks.push_back(all_warped_masks[i]);
     }
 }
 
 
+void CustomSphericalPanorama::Warping(vector<vector<Mat>>& images, vector<vector<CameraParameters>> cameraParams, vector<Mat>& warped_images, vector<Mat>& warped_masks, vector<Point>& corners, vector<Size>& sizes) {
+    /*
+        The rectilinear images of all sets are put in a single list,
+        so the images of different sets can be warped at the same time.
+        (the rectilinear images have a single scale, they are used both for the gains and for the warping)
+    */
+    vector<Mat> rectilinear_images, Ks, Rs;
+    vector<Size> rectilinear_sizes;
+    for (int i = 0; i < images.size(); i++) {
+        for (int j = 0; j < images[i].size(); j++) {
+            rectilinear_images.push_back(images[i][j]);
+            rectilinear_sizes.push_back(images[i][j].size());
+            Ks.push_back(cameraParams[i][j].getK());
+            Rs.push_back(cameraParams[i][j].getR());
+        }
+    }
+    images.clear();
+
+    imageWarper.estimateGains(projection, rectilinear_images, Ks, Rs);
+
+    /*
+        A rectilinear image (300x300) is much smaller than its fisheye image, so the rectilinear images are kept
+        instead of decoding the fisheye image again for each of them. Each one is released once it is warped.
+    */
+    imageWarper.warp(projection, rectilinear_sizes, Ks, Rs, [&](int i) {
+        Mat image = rectilinear_images[i];
+        rectilinear_images[i].release();
+        return image;
+    }, warped_images, warped_masks, corners, sizes);
+}
 
+void CustomSphericalPanorama::TiledRendering(vector<vector<Mat>>& images, vector<vector<CameraParameters>> cameraParams) {
+    vector<Mat> rectilinear_images, Ks, Rs;
+    vector<Size> rectilinear_sizes;
+    for (int i = 0; i < images.size(); i++) {
+        for (int j = 0; j < images[i].size(); j++) {
+            rectilinear_images.push_back(images[i][j]);
+            rectilinear_sizes.push_back(images[i][j].size());
+            Ks.push_back(cameraParams[i][j].getK());
+            Rs.push_back(cameraParams[i][j].getR());
+        }
+    }
+    images.clear();
+    imageWarper.estimateGains(projection, rectilinear_images, Ks, Rs);
+    vector<Mat> gainMaps(rectilinear_images.size());
+    for (int i = 0; i < gainMaps.size(); i++)
+        gainMaps[i] = imageWarper.gainCompensator.getGainMap(i);
+
+    // the rows go to the files with "-tiled" and "-dzi", or to an image in memory with "-feather".
+    PanoramaOutput output(SPHERICAL, options);
+    if (output.isInMemory())
+        input_output.StartFeatherCompositing();
+    output.finish(tiledRenderer.render(projection, rectilinear_sizes, Ks, Rs, gainMaps, [&](int i) {
+        // the rectilinear images are kept in memory (see Warping), the renderer may ask for an image more than once.
+        return rectilinear_images[i];
+    }, output.getWriter()));
+}
@@ -2,6 +2,7 @@
 #define  CUSTOM_SPHERICAL_PANORAMA_H 
 
 #include<iostream>
+#include <map>
 #include <opencv2/core.hpp>
 #include <omp.h>
 #include "opencv2/imgcodecs.hpp"
@@ -11,6 +12,14 @@
 #include "Blending.h"
 #include "Utils.h"
 #include "CustomRelationFinder.h"
+#include "WarpMap.h"
+#include "ImageWarper.h"
+#include "PanoramaOptions.h"
+#include "TiledRenderer.h"
+#include "PanoramaOutput.h"
+#include "Sampler.h"
+#include "ImageLoader.h"
+#include "FastMath.h"
 
 using namespace std;
 using namespace cv;
@@ -45,6 +54,24 @@ public:
 	// Applies multi-band blending algorithm to smoothly stitch the images.
 	Blending blending;
 
+	// Estimates the exposure gains, finds the areas of the warped images and warps them.
+	ImageWarper imageWarper;
+
+	// Bilinear interpolation of the fisheye images.
+	Sampler sampler;
+
+	// Renders the panorama tile by tile when "-tiled" is given.
+	TiledRenderer tiledRenderer;
+
+	// Optional settings given by the user.
+	PanoramaOptions options;
+
+	// Projection of the panorama (spherical by default, it can be changed with the "-projection" option).
+	PanoramaType projection = SPHERICAL;
+
+	// Remap tables of the rectilinear images for each (fisheye size, hfov, vfov).
+	map<string, vector<WarpMap>> fisheyeMaps;
+
 	/*
 		Start of the algorithm here ...
 	*/
@@ -79,25 +106,62 @@ public:
 	*/
 	void fish2persp(Mat& image, vector<Mat>& images, vector<CameraParameters>& cameraParams);
 
+	/*
+		Returns the remap tables (fisheye image point of each rectilinear image point) of all rectilinear images.
+		The virtual cameras only depend on the fisheye image size, hfov and vfov, so the tables are computed once
+		for each (size, hfov, vfov) and applied to all fisheye images taken with the same lens.
+		If "options.mapsDirectory" is set, the tables are also saved to / loaded from that directory (rig profile).
+	*/
+	const vector<WarpMap>& getFisheyeMaps(Size fisheyeSize, vector<CameraParameters>& cameraParams, int wd, int hd);
 
 	/*
-		Step by step warping operations are operated in this function.
+		Reads fisheye image i (index in "image_names") from the image store.
+		A file which can not be read anymore is reported.
 	*/
-	void Warping(vector<vector<Mat>> images, vector<vector<CameraParameters>> cameraParams, vector<Mat>& warped_images, vector<Mat>& warped_masks, vector<Point>& corners, vector<Size>& sizes);
-	
+	Mat loadFisheyeImage(vector<String>& image_names, int i);
+
 	/*
-		In this function , we apply forward warping operations to source image
-		and we get the size of the destination (spherical) image.
+		Computes the remap table of a single rectilinear image (virtual pinhole camera).
 	*/
-	Rect forwardWarping(Mat image, Mat K, Mat R);
-	
+	void buildFisheyeMap(Size fisheyeSize, CameraParameters camera, int wd, int hd, WarpMap& warpMap);
+
+	/*
+		Direct mode : the spherical image points are mapped straight to the fisheye image with the
+		same fisheye model as in fish2persp, so each fisheye image gives one spherical image and mask.
+		* R_fish -> rotation of the fisheye image set found by the relation finder
+		  (fisheye ray = R_fish * spherical ray).
+		* K -> calibration matrix of the rectilinear images, the spherical image has the same scale (fx, fy) as in the other mode.
+	*/
+	void fish2sphere(Mat& image, Rect roi, Mat K, Mat R_fish, Mat& warped_image, Mat& warped_mask);
 
 	/*
-		The function below applies backward mapping to each spherical image points,
-		finds the corresponding pixel value in the source (rectilinear) image, and 
-		gives this pixel value to the current pixel in spherical image using 
-		bilinear interpolation method.
+		Finds the area of the spherical image covered by the field of view of a fisheye image
+		by checking the spherical image points on a coarse grid.
+	*/
+	Rect findFisheyeRoi(Mat K, Mat R_fish);
+
+	/*
+		Warping operations of the direct mode (one spherical image for each fisheye image).
+		* fisheyeIndices -> index of each fisheye image in "image_names", the images are read from the image store
+		  when they are warped.
+		* fisheyeSizes -> sizes of all fisheye images (by index in "image_names").
+	*/
+	void DirectWarping(vector<String> image_names, vector<int> fisheyeIndices, vector<Size> fisheyeSizes, vector<Mat> fisheyeRotations, Mat K, vector<Mat>& warped_images, vector<Mat>& warped_masks, vector<Point>& corners, vector<Size>& sizes);
+
+
+	/*
+		Step by step warping operations are operated in this function.
+		The gains are estimated with the rectilinear images, which are also the images that are warped
+		(they are small, so they are kept instead of being derived again from the fisheye images).
+	*/
+	void Warping(vector<vector<Mat>>& images, vector<vector<CameraParameters>> cameraParams, vector<Mat>& warped_images, vector<Mat>& warped_masks, vector<Point>& corners, vector<Size>& sizes);
+	
+	/*
+		Renders the panorama of the rectilinear images tile by tile and writes it to "options.tiledOutput" and/or "options.dziOutput"
+		(or to the output image with "-feather").
+		As in Warping, the gains are estimated with the rectilinear images, which are then rendered.
+		("-direct" can not be combined with the tiled rendering, see IO::readOptions)
 	*/
-	void BackwardWarping(Mat image, Rect roi, Mat& warped_image, Mat& warped_mask, Mat K, Mat R);
+	void TiledRendering(vector<vector<Mat>>& images, vector<vector<CameraParameters>> cameraParams);
 };
 #endif
\ No newline at end of file
@@ -0,0 +1,155 @@
+#include "DeepZoomWriter.h"
+
+DeepZoomWriter::DeepZoomWriter(string name) {
+	if (name.size() > 4 && name.compare(name.size() - 4, 4, ".dzi") == 0)
+		name = name.substr(0, name.size() - 4);
+	base = name;
+}
+
+bool DeepZoomWriter::open(Size size) {
+	failed = false;
+
+	// the last level has the full resolution and each level is half of the next one (rounded up), down to a single pixel.
+	int max_level = 0;
+	while ((1 << max_level) < max(size.width, size.height))
+		max_level++;
+	levels.assign(max_level + 1, Level());
+	levels[max_level].size = size;
+	for (int l = max_level - 1; l >= 0; l--)
+		levels[l].size = Size((levels[l + 1].size.width + 1) / 2, (levels[l + 1].size.height + 1) / 2);
+
+	for (int l = 0; l <= max_level; l++) {
+		if (!utils::fs::createDirectories(getLevelDirectory(l)))
+			return false;
+	}
+
+	ofstream file(base + ".dzi");
+	if (!file.is_open())
+		return false;
+	file << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>" << endl
+		<< "<Image xmlns=\"http://schemas.microsoft.com/deepzoom/2008\" Format=\"" << format
+		<< "\" Overlap=\"" << overlap << "\" TileSize=\"" << tileSize << "\">" << endl
+		<< "  <Size Width=\"" << size.width << "\" Height=\"" << size.height << "\"/>" << endl
+		<< "</Image>" << endl;
+	return file.good();
+}
+
+void DeepZoomWriter::writeRows(const Mat& band) {
+	addRows((int)levels.size() - 1, band);
+}
+
+void DeepZoomWriter::close() {
+	// the last odd row of each level is averaged with itself, from the full resolution level to the smallest one.
+	for (int l = (int)levels.size() - 1; l > 0; l--) {
+		if (levels[l].pending.empty())
+			continue;
+		Mat rows, half;
+		vconcat(levels[l].pending, levels[l].pending, rows);
+		levels[l].pending.release();
+		halve(rows, levels[l - 1].size.width, half);
+		addRows(l - 1, half);
+	}
+	levels.clear();
+}
+
+bool DeepZoomWriter::good() {
+	return !failed;
+}
+
+void DeepZoomWriter::addRows(int level, const Mat& band) {
+	if (band.empty())
+		return;
+	Level& current = levels[level];
+
+	if (current.rows.empty())
+		current.rows = band.clone();
+	else
+		vconcat(current.rows, band, current.rows);
+
+	// writes the rows of tiles whose rows (with the overlap below) are all here.
+	int end = current.first + current.rows.rows;
+	while (current.tileRow * tileSize < current.size.height
+		&& min((current.tileRow + 1) * tileSize + overlap, current.size.height) <= end) {
+		writeTileRow(level, current.tileRow);
+		current.tileRow++;
+	}
+
+	// only the overlap above the next row of tiles is kept.
+	int drop = min(current.tileRow * tileSize - overlap - current.first, current.rows.rows);
+	if (drop > 0) {
+		current.rows = current.rows.rowRange(drop, current.rows.rows).clone();
+		current.first += drop;
+	}
+
+	if (level == 0)
+		return;
+
+	// the rows are averaged in pairs for the level above, an odd row waits for the next band.
+	Mat rows;
+	if (current.pending.empty())
+		rows = band;
+	else
+		vconcat(current.pending, band, rows);
+	int even = rows.rows & ~1;
+	current.pending = even < rows.rows ? rows.rowRange(even, rows.rows).clone() : Mat();
+	if (even > 0) {
+		Mat half;
+		halve(rows.rowRange(0, even), levels[level - 1].size.width, half);
+		addRows(level - 1, half);
+	}
+}
+
+void DeepZoomWriter::writeTileRow(int level, int tile_row) {
+	const Level& current = levels[level];
+	int columns = (current.size.width + tileSize - 1) / tileSize;
+	int y0 = max(0, tile_row * tileSize - overlap);
+	int y1 = min((tile_row + 1) * tileSize + overlap, current.size.height);
+	string directory = getLevelDirectory(level);
+
+	vector<int> params;
+	if (format.compare("jpg") == 0) {
+		params.push_back(IMWRITE_JPEG_QUALITY);
+		params.push_back(quality);
+	}
+
+	// the encoding takes most of the time, each thread encodes and writes its own tiles.
+#pragma omp parallel for schedule(dynamic)
+	for (int c = 0; c < columns; c++) {
+		int x0 = max(0, c * tileSize - overlap);
+		int x1 = min((c + 1) * tileSize + overlap, current.size.width);
+		Mat tile = current.rows(Rect(x0, y0 - current.first, x1 - x0, y1 - y0));
+
+		vector<uchar> bytes;
+		bool written = imencode("." + format, tile, bytes, params);
+		if (written) {
+			ofstream file(directory + "/" + to_string(c) + "_" + to_string(tile_row) + "." + format, ios::out | ios::binary);
+			file.write((const char*)bytes.data(), bytes.size());
+			written = file.good();
+		}
+		if (!written) {
+#pragma omp critical(deep_zoom_failed)
+			failed = true;
+		}
+	}
+}
+
+void DeepZoomWriter::halve(const Mat& band, int width, Mat& half) {
+	half.create(band.rows / 2, width, CV_8UC3);
+	int last = band.cols - 1;
+
+#pragma omp parallel for
+	for (int y = 0; y < half.rows; y++) {
+		const uchar* src0 = band.ptr<uchar>(2 * y);
+		const uchar* src1 = band.ptr<uchar>(2 * y + 1);
+		uchar* dst = half.ptr<uchar>(y);
+		for (int x = 0; x < width; x++) {
+			int a = 3 * (2 * x), b = 3 * min(2 * x + 1, last);
+			for (int k = 0; k < 3; k++)
+				dst[3 * x + k] = (uchar)((src0[a + k] + src0[b + k] + src1[a + k] + src1[b + k] + 2) >> 2);
+		}
+	}
+}
+
+string DeepZoomWriter::getLevelDirectory(int level) {
+	return base + "_files/" + to_string(level);
+}
@@ -0,0 +1,93 @@
+#ifndef  DEEP_ZOOM_WRITER_H
+#define  DEEP_ZOOM_WRITER_H
+
+#include <iostream>
+#include <fstream>
+#include <omp.h>
+#include <opencv2/core.hpp>
+#include <opencv2/core/utils/filesystem.hpp>
+#include "opencv2/imgcodecs.hpp"
+#include "OutputWriter.h"
+
+using namespace std;
+using namespace cv;
+
+/*
+	Writes the panorama as a Deep Zoom tile pyramid ("<name>.dzi" and the tiles "<name>_files/<level>/<column>_<row>.<format>"),
+	which the web viewers (e.g. OpenSeadragon) load tile by tile.
+
+	The pyramid is built while the bands arrive, in a single pass:
+	* Each level keeps only the rows of its current row of tiles. When the rows of a row of tiles are complete,
+	  its tiles are encoded and written in parallel.
+	* The rows of a level are averaged 2x2 as soon as they come in pairs and given to the level above
+	  (the last level has the full resolution, level 0 is a single pixel).
+	So the memory use is about one row of tiles per level, whatever the size of the panorama.
+*/
+class DeepZoomWriter : public OutputWriter {
+
+public:
+	// Size of the tiles without their overlap.
+	int tileSize = 254;
+
+	// Number of pixels the tiles share with their neighbours on each side.
+	int overlap = 1;
+
+	// Image format of the tiles ("jpg" or "png").
+	string format = "jpg";
+
+	// JPEG quality of the tiles.
+	int quality = 90;
+
+	/*
+		name -> path of the .dzi file (the extension is optional).
+	*/
+	DeepZoomWriter(string name);
+
+	bool open(Size size);
+
+	void writeRows(const Mat& band);
+
+	void close();
+
+	// Returns false if a tile could not be written.
+	bool good();
+
+private:
+	struct Level {
+		Size size;
+
+		// rows of the level starting from the row "first" (the rows still needed by the tiles).
+		Mat rows;
+		int first = 0;
+
+		// the next row of tiles to be written.
+		int tileRow = 0;
+
+		// a row waiting for its pair before it is averaged for the level above.
+		Mat pending;
+	};
+
+	string base;
+	vector<Level> levels;
+	bool failed = false;
+
+	/*
+		Adds rows to a level, writes its complete rows of tiles and gives the averaged rows to the level above.
+	*/
+	void addRows(int level, const Mat& band);
+
+	/*
+		Encodes and writes the tiles of a row of tiles (in parallel).
+	*/
+	void writeTileRow(int level, int tile_row);
+
+	/*
+		Averages each 2x2 block of pixels (an odd last column is averaged with itself).
+		"band" has an even number of rows.
+	*/
+	void halve(const Mat& band, int width, Mat& half);
+
+	string getLevelDirectory(int level);
+};
+
+#endif
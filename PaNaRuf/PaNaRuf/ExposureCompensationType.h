@@ -0,0 +1,12 @@
+#ifndef  EXPOSURE_COMPENSATION_TYPE_H  
+#define  EXPOSURE_COMPENSATION_TYPE_H 
+
+/*
+	Exposure compensation of the warped images (see GainCompensator).
+	* NO_EXPOSURE_COMPENSATION -> the images are not changed.
+	* GAIN_COMPENSATION -> a single gain for each image.
+	* BLOCKS_GAIN_COMPENSATION -> a smooth gain map of blocks for each image (also corrects vignetting).
+*/
+enum ExposureCompensationType { NO_EXPOSURE_COMPENSATION, GAIN_COMPENSATION, BLOCKS_GAIN_COMPENSATION };
+
+#endif 
@@ -0,0 +1,207 @@
+#include "FastMath.h"
+#include <cmath>
+
+#if !defined(PANARUF_USE_LIBM) && (defined(_M_X64) || defined(__x86_64__) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define PANARUF_FAST_MATH_SSE2
+#include <emmintrin.h>
+#endif
+
+/*
+	Constants of the approximations.
+	* sin, cos : x is reduced to [-pi/4, pi/4] by j * pi/4, where pi/4 = DP1 + DP2 + DP3 (Cody-Waite),
+	  so the reduction does not lose precision.
+	* atan : t is reduced to [0, tan(pi/8)] via atan(t) = pi/4 + atan((t - 1) / (t + 1)).
+*/
+static const float FOPI = 1.27323954473516f; // 4 / pi
+static const float DP1 = 0.78515625f;
+static const float DP2 = 2.4187564849853515625e-4f;
+static const float DP3 = 3.77489497744594108e-8f;
+static const float SIN_P0 = -1.9515295891e-4f;
+static const float SIN_P1 = 8.3321608736e-3f;
+static const float SIN_P2 = -1.6666654611e-1f;
+static const float COS_P0 = 2.443315711809948e-5f;
+static const float COS_P1 = -1.388731625493765e-3f;
+static const float COS_P2 = 4.166664568298827e-2f;
+static const float ATAN_P0 = 8.05374449538e-2f;
+static const float ATAN_P1 = -1.38776856032e-1f;
+static const float ATAN_P2 = 1.99777106478e-1f;
+static const float ATAN_P3 = -3.33329491539e-1f;
+static const float TAN_PI_8 = 0.4142135623730950f;
+static const float PI_F = 3.14159265358979f;
+static const float PI_2_F = 1.57079632679490f;
+static const float PI_4_F = 0.78539816339745f;
+
+void FastMath::sinCos(float x, float& s, float& c) {
+#ifdef PANARUF_USE_LIBM
+	s = std::sin(x);
+	c = std::cos(x);
+#else
+	bool negative = x < 0;
+	float ax = negative ? -x : x;
+
+	// octant (rounded up to an even number) and the reduced angle.
+	int j = (int)(ax * FOPI);
+	j = (j + 1) & ~1;
+	float y = (float)j;
+	float r = ((ax - y * DP1) - y * DP2) - y * DP3;
+	float z = r * r;
+
+	float ps = ((SIN_P0 * z + SIN_P1) * z + SIN_P2) * z * r + r;
+	float pc = ((COS_P0 * z + COS_P1) * z + COS_P2) * z * z - 0.5f * z + 1.0f;
+
+	bool swap = (j & 2) != 0;
+	s = swap ? pc : ps;
+	c = swap ? ps : pc;
+	if (negative != ((j & 4) != 0))
+		s = -s;
+	if (((j & 4) != 0) != ((j & 2) != 0))
+		c = -c;
+#endif
+}
+
+float FastMath::sin(float x) {
+	float s, c;
+	sinCos(x, s, c);
+	return s;
+}
+
+float FastMath::cos(float x) {
+	float s, c;
+	sinCos(x, s, c);
+	return c;
+}
+
+float FastMath::atan2(float y, float x) {
+#ifdef PANARUF_USE_LIBM
+	return std::atan2(y, x);
+#else
+	float ax = std::fabs(x), ay = std::fabs(y);
+	float num = ax < ay ? ax : ay;
+	float den = ax < ay ? ay : ax;
+	if (den == 0.0f)
+		return 0.0f;
+
+	// atan(t), t in [0, 1]
+	float t = num / den;
+	float offset = 0.0f;
+	if (t > TAN_PI_8) {
+		t = (t - 1.0f) / (t + 1.0f);
+		offset = PI_4_F;
+	}
+	float z = t * t;
+	float r = offset + (((ATAN_P0 * z + ATAN_P1) * z + ATAN_P2) * z + ATAN_P3) * z * t + t;
+
+	// back to the octant of (x, y).
+	if (ay > ax)
+		r = PI_2_F - r;
+	if (x < 0)
+		r = PI_F - r;
+	return (y < 0) ? -r : r;
+#endif
+}
+
+float FastMath::acos(float x) {
+#ifdef PANARUF_USE_LIBM
+	return std::acos(x);
+#else
+	return atan2(std::sqrt((1.0f - x) * (1.0f + x)), x);
+#endif
+}
+
+float FastMath::sqrt(float x) {
+	return std::sqrt(x);
+}
+
+void FastMath::sinCos(const float* x, float* s, float* c, int n) {
+	int i = 0;
+#ifdef PANARUF_FAST_MATH_SSE2
+	const __m128 sign_mask = _mm_castsi128_ps(_mm_set1_epi32(0x80000000));
+	for (; i <= n - 4; i += 4) {
+		__m128 v = _mm_loadu_ps(x + i);
+		__m128 sign = _mm_and_ps(v, sign_mask);
+		__m128 ax = _mm_andnot_ps(sign_mask, v);
+
+		__m128i j = _mm_cvttps_epi32(_mm_mul_ps(ax, _mm_set1_ps(FOPI)));
+		j = _mm_and_si128(_mm_add_epi32(j, _mm_set1_epi32(1)), _mm_set1_epi32(~1));
+		__m128 y = _mm_cvtepi32_ps(j);
+		__m128 r = _mm_sub_ps(ax, _mm_mul_ps(y, _mm_set1_ps(DP1)));
+		r = _mm_sub_ps(r, _mm_mul_ps(y, _mm_set1_ps(DP2)));
+		r = _mm_sub_ps(r, _mm_mul_ps(y, _mm_set1_ps(DP3)));
+		__m128 z = _mm_mul_ps(r, r);
+
+		__m128 ps = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(SIN_P0), z), _mm_set1_ps(SIN_P1));
+		ps = _mm_add_ps(_mm_mul_ps(ps, z), _mm_set1_ps(SIN_P2));
+		ps = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(ps, z), r), r);
+
+		__m128 pc = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(COS_P0), z), _mm_set1_ps(COS_P1));
+		pc = _mm_add_ps(_mm_mul_ps(pc, z), _mm_set1_ps(COS_P2));
+		pc = _mm_mul_ps(_mm_mul_ps(pc, z), z);
+		pc = _mm_add_ps(_mm_sub_ps(pc, _mm_mul_ps(_mm_set1_ps(0.5f), z)), _mm_set1_ps(1.0f));
+
+		// polynomial selection and signs from the octant.
+		__m128 swap = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(j, _mm_set1_epi32(2)), _mm_set1_epi32(2)));
+		__m128 vs = _mm_or_ps(_mm_and_ps(swap, pc), _mm_andnot_ps(swap, ps));
+		__m128 vc = _mm_or_ps(_mm_and_ps(swap, ps), _mm_andnot_ps(swap, pc));
+		__m128 bit4 = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(j, _mm_set1_epi32(4)), 29));
+		__m128 bit2 = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(j, _mm_set1_epi32(2)), 30));
+		vs = _mm_xor_ps(vs, _mm_xor_ps(sign, bit4));
+		vc = _mm_xor_ps(vc, _mm_xor_ps(bit4, bit2));
+
+		_mm_storeu_ps(s + i, vs);
+		_mm_storeu_ps(c + i, vc);
+	}
+#endif
+	for (; i < n; i++)
+		sinCos(x[i], s[i], c[i]);
+}
+
+void FastMath::atan2(const float* y, const float* x, float* out, int n) {
+	int i = 0;
+#ifdef PANARUF_FAST_MATH_SSE2
+	const __m128 sign_mask = _mm_castsi128_ps(_mm_set1_epi32(0x80000000));
+	const __m128 zero = _mm_setzero_ps();
+	for (; i <= n - 4; i += 4) {
+		__m128 vx = _mm_loadu_ps(x + i);
+		__m128 vy = _mm_loadu_ps(y + i);
+		__m128 ax = _mm_andnot_ps(sign_mask, vx);
+		__m128 ay = _mm_andnot_ps(sign_mask, vy);
+
+		__m128 num = _mm_min_ps(ax, ay);
+		__m128 den = _mm_max_ps(ax, ay);
+		__m128 valid = _mm_cmpgt_ps(den, zero);
+		__m128 t = _mm_and_ps(valid, _mm_div_ps(num, _mm_or_ps(den, _mm_andnot_ps(valid, _mm_set1_ps(1.0f)))));
+
+		// atan(t), t in [0, 1]
+		__m128 big = _mm_cmpgt_ps(t, _mm_set1_ps(TAN_PI_8));
+		__m128 reduced = _mm_div_ps(_mm_sub_ps(t, _mm_set1_ps(1.0f)), _mm_add_ps(t, _mm_set1_ps(1.0f)));
+		t = _mm_or_ps(_mm_and_ps(big, reduced), _mm_andnot_ps(big, t));
+		__m128 offset = _mm_and_ps(big, _mm_set1_ps(PI_4_F));
+		__m128 z = _mm_mul_ps(t, t);
+		__m128 p = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(ATAN_P0), z), _mm_set1_ps(ATAN_P1));
+		p = _mm_add_ps(_mm_mul_ps(p, z), _mm_set1_ps(ATAN_P2));
+		p = _mm_add_ps(_mm_mul_ps(p, z), _mm_set1_ps(ATAN_P3));
+		__m128 r = _mm_add_ps(offset, _mm_add_ps(_mm_mul_ps(_mm_mul_ps(p, z), t), t));
+
+		// back to the octant of (x, y).
+		__m128 steep = _mm_cmpgt_ps(ay, ax);
+		r = _mm_or_ps(_mm_and_ps(steep, _mm_sub_ps(_mm_set1_ps(PI_2_F), r)), _mm_andnot_ps(steep, r));
+		__m128 left = _mm_cmplt_ps(vx, zero);
+		r = _mm_or_ps(_mm_and_ps(left, _mm_sub_ps(_mm_set1_ps(PI_F), r)), _mm_andnot_ps(left, r));
+		__m128 below = _mm_cmplt_ps(vy, zero);
+		r = _mm_xor_ps(r, _mm_and_ps(below, sign_mask));
+		_mm_storeu_ps(out + i, _mm_and_ps(valid, r));
+	}
+#endif
+	for (; i < n; i++)
+		out[i] = atan2(y[i], x[i]);
+}
+
+void FastMath::sqrt(const float* x, float* out, int n) {
+	int i = 0;
+#ifdef PANARUF_FAST_MATH_SSE2
+	for (; i <= n - 4; i += 4)
+		_mm_storeu_ps(out + i, _mm_sqrt_ps(_mm_loadu_ps(x + i)));
+#endif
+	for (; i < n; i++)
+		out[i] = std::sqrt(x[i]);
+}
@@ -0,0 +1,46 @@
+#ifndef  FAST_MATH_H
+#define  FAST_MATH_H
+
+#include <iostream>
+
+using namespace std;
+
+/*
+	Single precision sin, cos, atan2, acos and sqrt for the projection math of the warpings.
+
+	* The functions use range reduction and short polynomials (as in the Cephes library),
+	  the absolute error is about 2e-7 radians (sin, cos : |x| < 1e4), which is below
+	  1/1000 pixel even at a focal length of several thousand pixels.
+	* The batch functions process 4 values at a time with SSE2.
+	* If PANARUF_USE_LIBM is defined at build time, all of the functions call the standard library
+	  instead, so the results of the approximations can be validated against libm.
+*/
+class FastMath {
+
+public:
+	static float sin(float x);
+
+	static float cos(float x);
+
+	static void sinCos(float x, float& s, float& c);
+
+	/*
+		Returns the angle of (x, y) in [-pi, pi], atan2(0, 0) is 0.
+	*/
+	static float atan2(float y, float x);
+
+	static float acos(float x);
+
+	static float sqrt(float x);
+
+	/*
+		Batch versions : out[i] = f(in[i]), i = 0 ... n-1.
+	*/
+	static void sinCos(const float* x, float* s, float* c, int n);
+
+	static void atan2(const float* y, const float* x, float* out, int n);
+
+	static void sqrt(const float* x, float* out, int n);
+};
+
+#endif
@@ -0,0 +1,139 @@
+#include "GainCompensator.h"
+
+void GainCompensator::estimate(const vector<Mat>& images, const vector<Rect>& rois, const function<void(int, Rect, WarpMap&)>& buildMap) {
+	int n = (int)images.size();
+	gainMaps.assign(n, Mat());
+	if (type == NO_EXPOSURE_COMPENSATION)
+		return;
+
+	// each block of each image is an unknown of the system, the blocks of image i start at first[i].
+	vector<Size> grids(n);
+	vector<int> first(n + 1, 0);
+	for (int i = 0; i < n; i++) {
+		grids[i] = rois[i].empty() ? Size(0, 0) : getBlockGrid(rois[i].size());
+		first[i + 1] = first[i] + grids[i].area();
+	}
+	int blocks = first[n];
+	if (blocks == 0)
+		return;
+
+	RoiIndex roiIndex;
+	roiIndex.build(rois);
+	vector<pair<int, int>> pairs;
+	vector<Rect> overlap_rects;
+	roiIndex.overlaps(pairs, overlap_rects);
+
+	/*
+		Statistics of each pair of blocks : (number of points, sum of the intensities of the first block, sum of the second).
+		The pairs of images are processed in parallel, each one with its own statistics.
+	*/
+	vector<map<pair<int, int>, Vec3d>> pair_stats(pairs.size());
+#pragma omp parallel for schedule(dynamic)
+	for (int p = 0; p < pairs.size(); p++) {
+		int i = pairs[p].first, j = pairs[p].second;
+		Rect overlap = overlap_rects[p];
+		int step = max(1, statsStep);
+
+		vector<float> xs_i, ys_i, xs_j, ys_j;
+		vector<int> columns;
+		vector<uchar> colors_i, colors_j;
+		for (int y = overlap.y + step / 2; y < overlap.br().y; y += step) {
+			// only this row of the overlap is mapped to the source images.
+			WarpMap map_i, map_j;
+			buildMap(i, Rect(overlap.x, y, overlap.width, 1), map_i);
+			buildMap(j, Rect(overlap.x, y, overlap.width, 1), map_j);
+
+			xs_i.clear(); ys_i.clear(); xs_j.clear(); ys_j.clear(); columns.clear();
+			for (int x = step / 2; x < overlap.width; x += step) {
+				if (!map_i.mask.at<uchar>(0, x) || !map_j.mask.at<uchar>(0, x))
+					continue;
+				columns.push_back(x);
+				xs_i.push_back(map_i.map_x.at<float>(0, x));
+				ys_i.push_back(map_i.map_y.at<float>(0, x));
+				xs_j.push_back(map_j.map_x.at<float>(0, x));
+				ys_j.push_back(map_j.map_y.at<float>(0, x));
+			}
+			if (columns.empty())
+				continue;
+
+			colors_i.resize(3 * columns.size());
+			colors_j.resize(3 * columns.size());
+			sampler.sampleBatch(images[i], xs_i.data(), ys_i.data(), (int)columns.size(), colors_i.data());
+			sampler.sampleBatch(images[j], xs_j.data(), ys_j.data(), (int)columns.size(), colors_j.data());
+
+			for (int k = 0; k < columns.size(); k++) {
+				int px = overlap.x + columns[k];
+				int bi = first[i] + ((y - rois[i].y) * grids[i].height / rois[i].height) * grids[i].width + (px - rois[i].x) * grids[i].width / rois[i].width;
+				int bj = first[j] + ((y - rois[j].y) * grids[j].height / rois[j].height) * grids[j].width + (px - rois[j].x) * grids[j].width / rois[j].width;
+				const uchar* ci = &colors_i[3 * k];
+				const uchar* cj = &colors_j[3 * k];
+				Vec3d& s = pair_stats[p][make_pair(bi, bj)];
+				s[0] += 1.0;
+				s[1] += sqrt((double)(ci[0] * ci[0] + ci[1] * ci[1] + ci[2] * ci[2]));
+				s[2] += sqrt((double)(cj[0] * cj[0] + cj[1] * cj[1] + cj[2] * cj[2]));
+			}
+		}
+	}
+
+	/*
+		The system of OpenCV's GainCompensator, with the blocks as unknowns:
+			minimize sum N(a, b) * ((g_a * I(a, b) - g_b * I(b, a))^2 / sigma_n^2 + (1 - g_a)^2 / sigma_g^2)
+		The blocks without any overlap keep the gain 1.
+	*/
+	const double alpha = 0.01; // 1 / sigma_n^2
+	const double beta = 100;   // 1 / sigma_g^2
+	Mat A = Mat::zeros(blocks, blocks, CV_64F);
+	Mat b = Mat::zeros(blocks, 1, CV_64F);
+	for (int a = 0; a < blocks; a++) {
+		// every block is pulled towards the gain 1, so the system is positive definite even for the blocks without overlaps.
+		A.at<double>(a, a) = beta;
+		b.at<double>(a, 0) = beta;
+	}
+	for (int p = 0; p < pair_stats.size(); p++) {
+		for (map<pair<int, int>, Vec3d>::const_iterator it = pair_stats[p].begin(); it != pair_stats[p].end(); ++it) {
+			int ba = it->first.first, bb = it->first.second;
+			double N = it->second[0];
+			double Iab = it->second[1] / N, Iba = it->second[2] / N;
+
+			A.at<double>(ba, ba) += beta * N + 2 * alpha * Iab * Iab * N;
+			A.at<double>(bb, bb) += beta * N + 2 * alpha * Iba * Iba * N;
+			A.at<double>(ba, bb) -= 2 * alpha * Iab * Iba * N;
+			A.at<double>(bb, ba) -= 2 * alpha * Iab * Iba * N;
+			b.at<double>(ba, 0) += beta * N;
+			b.at<double>(bb, 0) += beta * N;
+		}
+	}
+
+	Mat gains;
+	if (!solve(A, b, gains, DECOMP_CHOLESKY))
+		return;
+
+	for (int i = 0; i < n; i++) {
+		if (grids[i].area() == 0)
+			continue;
+		Mat gain_map(grids[i], CV_32F);
+		for (int k = 0; k < grids[i].area(); k++)
+			gain_map.at<float>(k / grids[i].width, k % grids[i].width) = (float)gains.at<double>(first[i] + k, 0);
+
+		// the gains of the neighbouring blocks are smoothed (as in OpenCV's BlocksGainCompensator).
+		if (gain_map.total() > 1) {
+			Mat_<float> kernel(1, 3);
+			kernel << 0.25f, 0.5f, 0.25f;
+			sepFilter2D(gain_map, gain_map, CV_32F, kernel, kernel, Point(-1, -1), 0, BORDER_REFLECT);
+			sepFilter2D(gain_map, gain_map, CV_32F, kernel, kernel, Point(-1, -1), 0, BORDER_REFLECT);
+		}
+		gainMaps[i] = gain_map;
+	}
+}
+
+Mat GainCompensator::getGainMap(int i) const {
+	return i < gainMaps.size() ? gainMaps[i] : Mat();
+}
+
+Size GainCompensator::getBlockGrid(Size size) {
+	if (type != BLOCKS_GAIN_COMPENSATION)
+		return Size(1, 1);
+	int bw = min(maxBlocks, max(1, size.width / minBlockSize));
+	int bh = min(maxBlocks, max(1, size.height / minBlockSize));
+	return Size(bw, bh);
+}
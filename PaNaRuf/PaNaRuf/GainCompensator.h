@@ -0,0 +1,68 @@
+#ifndef  GAIN_COMPENSATOR_H
+#define  GAIN_COMPENSATOR_H
+
+#include <iostream>
+#include <map>
+#include <functional>
+#include <omp.h>
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+#include "ExposureCompensationType.h"
+#include "WarpMap.h"
+#include "Sampler.h"
+#include "RoiIndex.h"
+
+using namespace std;
+using namespace cv;
+
+/*
+	Estimates the exposure gains of the images before they are warped, so the gains can be applied
+	by the sampler during the backward warping (no extra pass over the warped images).
+
+	* The overlaps of the images are found with RoiIndex. In each overlap, the rows and columns of a coarse grid
+	  ("statsStep") are mapped to both source images and the mean intensities of each pair of blocks are collected.
+	  Only these grid rows of the maps are computed.
+	* The gains minimize the intensity differences in the overlaps while staying close to 1
+	  (the same linear system as OpenCV's GainCompensator, each block is an unknown).
+	* With blocks, the gain maps are smoothed, and the gain of a pixel is interpolated between the centers of the blocks.
+*/
+class GainCompensator {
+
+public:
+	ExposureCompensationType type = NO_EXPOSURE_COMPENSATION;
+
+	// Maximum number of blocks along each side of a warped image (BLOCKS_GAIN_COMPENSATION).
+	int maxBlocks = 8;
+
+	// Minimum size of a block in pixels of the warped image.
+	int minBlockSize = 32;
+
+	// Distance between the grid points at which the overlaps are compared.
+	int statsStep = 4;
+
+	/*
+		Estimates the gain map of each image.
+		* rois -> destination areas of the images (empty if the image is not warped).
+		* buildMap -> computes the (float) warp map of an area of image i.
+	*/
+	void estimate(const vector<Mat>& images, const vector<Rect>& rois, const function<void(int, Rect, WarpMap&)>& buildMap);
+
+	/*
+		Returns the gain map (CV_32F, one value per block) of image i,
+		or an empty Mat if the image does not need to be changed.
+	*/
+	Mat getGainMap(int i) const;
+
+private:
+	// Reads the intensities at the grid points (constant border).
+	Sampler sampler;
+
+	vector<Mat> gainMaps;
+
+	/*
+		Number of blocks along each side of a warped image of the given size.
+	*/
+	Size getBlockGrid(Size size);
+};
+
+#endif
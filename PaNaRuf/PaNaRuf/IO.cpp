@@ -12,6 +12,87 @@ void IO :: readImageNames(vector<string>& image_names, char* argv[]) {
 	}
 }
 
+bool IO::readOptions(int argc, char* argv[], int first, PanoramaOptions& options) {
+	for (int i = first; i < argc; i++) {
+		string option = argv[i];
+		if (option.compare("-maps") == 0 && i + 1 < argc)
+			options.mapsDirectory = argv[++i];
+		else if (option.compare("-direct") == 0)
+			options.directFisheye = true;
+		else if (option.compare("-tiled") == 0 && i + 1 < argc)
+			options.tiledOutput = argv[++i];
+		else if (option.compare("-dzi") == 0 && i + 1 < argc)
+			options.dziOutput = argv[++i];
+		else if (option.compare("-feather") == 0)
+			options.feather = true;
+		else if (option.compare("-exposure") == 0 && i + 1 < argc) {
+			string name = argv[++i];
+			if (name.compare("none") == 0)
+				options.exposure = NO_EXPOSURE_COMPENSATION;
+			else if (name.compare("gain") == 0)
+				options.exposure = GAIN_COMPENSATION;
+			else if (name.compare("blocks") == 0)
+				options.exposure = BLOCKS_GAIN_COMPENSATION;
+			else
+				return false;
+		}
+		else if (option.compare("-seam") == 0 && i + 1 < argc) {
+			string name = argv[++i];
+			if (name.compare("voronoi") == 0)
+				options.seamFinder = VORONOI_SEAM;
+			else if (name.compare("dp") == 0)
+				options.seamFinder = DP_SEAM;
+			else if (name.compare("graphcut") == 0)
+				options.seamFinder = GRAPH_CUT_SEAM;
+			else
+				return false;
+		}
+		else if (option.compare("-seam_megapix") == 0 && i + 1 < argc)
+			options.seamMegapix = atof(argv[++i]);
+		else if (option.compare("-compose_megapix") == 0 && i + 1 < argc)
+			options.composeMegapix = atof(argv[++i]);
+		else if (option.compare("-projection") == 0 && i + 1 < argc) {
+			string name = argv[++i];
+			if (name.compare("cylindrical") == 0)
+				options.projection = CYLINDRICAL;
+			else if (name.compare("spherical") == 0)
+				options.projection = SPHERICAL;
+			else if (name.compare("planar") == 0)
+				options.projection = PLANAR;
+			else if (name.compare("stereographic") == 0)
+				options.projection = STEREOGRAPHIC;
+			else if (name.compare("mercator") == 0)
+				options.projection = MERCATOR;
+			else if (name.compare("equisolid") == 0)
+				options.projection = EQUISOLID;
+			else
+				return false;
+		}
+		else
+			return false;
+	}
+
+	/*
+		The direct fisheye mode maps each fisheye image straight to the equirectangular panorama
+		and blends them in memory, so it does not support the other projections, the tiled/feather rendering
+		and the exposure compensation.
+	*/
+	if (options.directFisheye && options.projection != NONE && options.projection != SPHERICAL) {
+		unsupportedOptionsError("-direct", "-projection");
+		return false;
+	}
+	if (options.directFisheye && (!options.tiledOutput.empty() || options.feather)) {
+		unsupportedOptionsError("-direct", options.feather ? "-feather" : "-tiled");
+		return false;
+	}
+	if (options.directFisheye && options.exposure != NO_EXPOSURE_COMPENSATION) {
+		// the gains are estimated with the rectilinear images, they do not apply to the fisheye images.
+		unsupportedOptionsError("-direct", "-exposure");
+		return false;
+	}
+	return true;
+}
+
 void IO::writeFieldOfViewError() {
 	cout << "Please write the horizontal field of view in argv[2] and/or the vertical field of view in argv[3]." << endl;
 }
@@ -24,9 +105,39 @@ void IO::provideCorrectInputError() {
 	cout << "Please write the input correctly." << endl
 		<< "arg1: */*.txt file containing the image files." << endl
 		<< "arg2: Type of panorama (e.g  -p - perspective, -c - cylindrical, -s - spherical)." << endl
-		<< "arg3: If the type of panorama is -s - spherical then also write horizontal and vertical field of view (e.g hfov = 180  vfov = 180)." << endl;
+		<< "arg3: If the type of panorama is -s - spherical then also write horizontal and vertical field of view (e.g hfov = 180  vfov = 180)." << endl
+		<< "Options (after the arguments above):" << endl
+		<< "-maps <dir>: Saves the warp maps to (and loads them from) the directory <dir>." << endl
+		<< "-direct: (-s only) Warps each fisheye image directly to the sphere instead of warping its rectilinear images (not with -projection, -tiled, -feather or -exposure)." << endl
+		<< "-projection <name>: (-c and -s) Projection of the panorama: cylindrical, spherical, planar, stereographic, mercator or equisolid." << endl
+		<< "-tiled <file.ppm>: Renders the panorama tile by tile (feather blending) and streams it to <file.ppm>, for panoramas larger than the memory." << endl
+		<< "-dzi <name>: Writes the panorama as a Deep Zoom tile pyramid (<name>.dzi and <name>_files) for web viewers." << endl
+		<< "-feather: Fast mode: the images are warped and feather-blended directly into the panorama (no seams, no multi-band blending)." << endl
+		<< "-exposure <name>: Exposure compensation of the warped images: none (default), gain or blocks." << endl
+		<< "-seam <name>: Seam finder: voronoi, dp or graphcut (default)." << endl
+		<< "-seam_megapix <value>: Resolution of the seam finding in megapixels (default 0.1, 0 for full resolution)." << endl
+		<< "-compose_megapix <value>: (-p and -c) Resolution of the panorama in megapixels of an input image (default 0, the work scale of about 0.6 megapixels; -1 for the original resolution)." << endl;
+}
+
+void IO::unsupportedOptionsError(string option, string other_option) {
+	cout << "The option " << option << " can not be used together with " << other_option << "." << endl;
+}
+
+void IO::StartTiledRendering(string file_name) {
+	cout << "Rendering the panorama tile by tile to " << file_name << " ..." << endl;
+}
+
+void IO::tiledOutputError(string file_name) {
+	cout << "The panorama could not be written to " << file_name << ". Please check the file name and try again." << endl;
+}
+
+void IO::StartWritingTilePyramid(string file_name) {
+	cout << "Writing the tile pyramid " << file_name << " ..." << endl;
 }
 
+void IO::StartFeatherCompositing() {
+	cout << "Compositing the images with feathering..." << endl;
+}
 
 void IO::readingError(string image_name) {
 	cout << "The image with name " << image_name << " gives empty error.Please check the reason and try again." << endl;
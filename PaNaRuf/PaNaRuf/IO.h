@@ -7,6 +7,7 @@
 #include "PairwiseMatches.h"
 #include "PanoramaType.h"
 #include "CameraParameters.h"
+#include "PanoramaOptions.h"
 using namespace std;
 using namespace cv;
 
@@ -20,6 +21,12 @@ public:
 		Reads inputs from argv and stores in "image_names"
 	*/
 	void readImageNames(vector<string>& image_names, char* argv[]);
+
+	/*
+		Reads the optional settings (e.g. "-maps <dir>") from argv[first] ... argv[argc-1] and stores them in "options".
+		Returns false if an unknown option or an unsupported combination of options (e.g. "-direct -tiled") is given.
+	*/
+	bool readOptions(int argc, char* argv[], int first, PanoramaOptions& options);
 	
 	/*
 		The below functions are for printing error/results/information to the user.
@@ -32,6 +39,8 @@ public:
 
 	void readingError(string image_name);
 
+	void unsupportedOptionsError(string option, string other_option);
+
 	void NoEnoughImagesException();
 
 	void NoEnoughPairedImagesException();
@@ -64,6 +73,14 @@ public:
 
 	void StartApplyingBlending();
 
+	void StartTiledRendering(string file_name);
+
+	void tiledOutputError(string file_name);
+
+	void StartWritingTilePyramid(string file_name);
+
+	void StartFeatherCompositing();
+
 	void prepareOutputImage(PanoramaType panoType, Mat result);
 };
 #endif
\ No newline at end of file
@@ -0,0 +1,192 @@
+#include "ImageLoader.h"
+#include <algorithm>
+
+#if defined(__linux__)
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+ImageLoader::~ImageLoader() {
+	stop();
+}
+
+void ImageLoader::start(const vector<String>& image_names) {
+	stop();
+	names = image_names;
+	frames.assign(names.size(), Mat());
+	originalSizes.assign(names.size(), Size());
+	done.assign(names.size(), false);
+	next = 0;
+	taken = 0;
+	stopping = false;
+
+	int count = threads > 0 ? threads : max(1, (int)thread::hardware_concurrency());
+	count = min(count, max(1, (int)names.size()));
+	for (int k = 0; k < count; k++)
+		workers.push_back(thread(&ImageLoader::work, this));
+}
+
+Mat ImageLoader::get(int i) {
+	unique_lock<mutex> guard(lock);
+	imageReady.wait(guard, [&] { return done[i]; });
+
+	Mat image = frames[i];
+	frames[i].release();
+	taken = max(taken, i + 1);
+	spaceReady.notify_all();
+	return image;
+}
+
+Size ImageLoader::getOriginalSize(int i) {
+	lock_guard<mutex> guard(lock);
+	return originalSizes[i];
+}
+
+void ImageLoader::stop() {
+	{
+		lock_guard<mutex> guard(lock);
+		stopping = true;
+	}
+	spaceReady.notify_all();
+	for (int k = 0; k < workers.size(); k++)
+		workers[k].join();
+	workers.clear();
+}
+
+void ImageLoader::work() {
+	vector<uchar> bytes;
+	while (true) {
+		int i;
+		{
+			// the next image is taken only if it is within the readahead window of the caller.
+			unique_lock<mutex> guard(lock);
+			spaceReady.wait(guard, [&] { return stopping || next >= (int)names.size() || next < taken + readahead; });
+			if (stopping || next >= (int)names.size())
+				return;
+			i = next++;
+		}
+
+		Mat image;
+		Size original_size;
+		if (readFile(names[i], bytes))
+			image = decode(bytes, original_size);
+
+		{
+			lock_guard<mutex> guard(lock);
+			frames[i] = image;
+			originalSizes[i] = original_size;
+			done[i] = true;
+		}
+		imageReady.notify_all();
+	}
+}
+
+bool ImageLoader::readFile(const string& file_name, vector<uchar>& bytes) {
+#if defined(__linux__)
+	// asks the kernel to read the whole file ahead, so the read below does not wait for each block.
+	int fd = open(file_name.c_str(), O_RDONLY);
+	if (fd >= 0) {
+		posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+		posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+		close(fd);
+	}
+#endif
+	ifstream file(file_name, ios::in | ios::binary);
+	if (!file.is_open())
+		return false;
+	file.seekg(0, ios::end);
+	streamoff size = file.tellg();
+	if (size <= 0)
+		return false;
+	file.seekg(0, ios::beg);
+	bytes.resize((size_t)size);
+	file.read((char*)bytes.data(), size);
+	return file.good();
+}
+
+Size ImageLoader::readImageSize(const string& file_name) {
+	vector<uchar> bytes;
+	if (!readFile(file_name, bytes))
+		return Size();
+	Size size;
+	if (parseImageSize(bytes, size))
+		return size;
+	return imdecode(bytes, IMREAD_COLOR).size();
+}
+
+bool ImageLoader::parseImageSize(const vector<uchar>& bytes, Size& size) {
+	size_t n = bytes.size();
+
+	// PNG : the width and height are the first fields of the IHDR chunk.
+	const uchar png[8] = { 0x89, 'P', 'N', 'G', 0x0D, 0x0A, 0x1A, 0x0A };
+	if (n >= 24 && equal(png, png + 8, bytes.begin())) {
+		size.width = (bytes[16] << 24) | (bytes[17] << 16) | (bytes[18] << 8) | bytes[19];
+		size.height = (bytes[20] << 24) | (bytes[21] << 16) | (bytes[22] << 8) | bytes[23];
+		return size.area() > 0;
+	}
+
+	// JPEG : the segments are skipped until a start of frame (SOF0 ... SOF15, except DHT, JPG and DAC).
+	if (n < 4 || bytes[0] != 0xFF || bytes[1] != 0xD8)
+		return false;
+	size_t pos = 2;
+	while (pos + 4 <= n) {
+		if (bytes[pos] != 0xFF)
+			return false;
+		uchar marker = bytes[pos + 1];
+		if (marker == 0xFF) {
+			pos++;
+			continue;
+		}
+		if (marker == 0x01 || (marker >= 0xD0 && marker <= 0xD8)) {
+			pos += 2;
+			continue;
+		}
+		int length = (bytes[pos + 2] << 8) | bytes[pos + 3];
+		if (marker >= 0xC0 && marker <= 0xCF && marker != 0xC4 && marker != 0xC8 && marker != 0xCC) {
+			if (pos + 9 > n)
+				return false;
+			size.height = (bytes[pos + 5] << 8) | bytes[pos + 6];
+			size.width = (bytes[pos + 7] << 8) | bytes[pos + 8];
+			return size.area() > 0;
+		}
+		pos += 2 + length;
+	}
+	return false;
+}
+
+Mat ImageLoader::decode(const vector<uchar>& bytes, Size& original_size) {
+	Size header_size;
+	bool known = parseImageSize(bytes, header_size);
+
+	// the largest reduction whose size is still at least the needed scale.
+	int reduction = 1;
+	if (known && (flags == IMREAD_COLOR || flags == IMREAD_GRAYSCALE)) {
+		while (reduction < 8 && 1.0 / (2 * reduction) >= scale)
+			reduction *= 2;
+	}
+
+	int reduced_flags = flags;
+	if (reduction > 1) {
+		bool color = flags == IMREAD_COLOR;
+		if (reduction == 2)
+			reduced_flags = color ? IMREAD_REDUCED_COLOR_2 : IMREAD_REDUCED_GRAYSCALE_2;
+		else if (reduction == 4)
+			reduced_flags = color ? IMREAD_REDUCED_COLOR_4 : IMREAD_REDUCED_GRAYSCALE_4;
+		else
+			reduced_flags = color ? IMREAD_REDUCED_COLOR_8 : IMREAD_REDUCED_GRAYSCALE_8;
+	}
+
+	Mat image = imdecode(bytes, reduced_flags);
+	if (image.empty())
+		return image;
+
+	if (!known)
+		original_size = image.size();
+	else {
+		// the decoder rotates the image with its EXIF orientation, then the header size is rotated too.
+		int reduced_width = (header_size.width + reduction - 1) / reduction;
+		bool rotated = abs(image.cols - reduced_width) > 1 && image.cols != image.rows;
+		original_size = rotated ? Size(header_size.height, header_size.width) : header_size;
+	}
+	return image;
+}
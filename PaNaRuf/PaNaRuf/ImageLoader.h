@@ -0,0 +1,110 @@
+#ifndef  IMAGE_LOADER_H
+#define  IMAGE_LOADER_H
+
+#include <iostream>
+#include <fstream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <opencv2/core.hpp>
+#include "opencv2/imgcodecs.hpp"
+
+using namespace std;
+using namespace cv;
+
+/*
+	Reads and decodes the input images on background threads while the caller works on the previous ones.
+
+	* Several worker threads read the files (the whole file at once, with a readahead hint to the OS where it is supported)
+	  and decode them from memory, so the disk reads and the decoding of different images overlap.
+	* The caller takes the images in order with "get", which only waits if the image is not decoded yet.
+	* At most "readahead" decoded images wait for the caller, so the memory use is bounded.
+	* If the images are needed at a smaller "scale", they are decoded at the smallest 1/2, 1/4 or 1/8 size which is still
+	  at least that scale (JPEG decoders scale in the DCT domain, which is several times faster than a full decode),
+	  and the caller only applies a small final resize.
+*/
+class ImageLoader {
+
+public:
+	// Number of worker threads (0 -> number of CPU cores).
+	int threads = 0;
+
+	// Maximum number of images decoded ahead of the caller.
+	int readahead = 8;
+
+	// Flags given to imdecode.
+	int flags = IMREAD_COLOR;
+
+	// Scale at which the images are needed (<= 1).
+	double scale = 1.0;
+
+	~ImageLoader();
+
+	/*
+		Starts reading the images in the background.
+	*/
+	void start(const vector<String>& image_names);
+
+	/*
+		Returns image i (waits until it is decoded). The loader does not keep the image after this call.
+		Returns an empty Mat if the image could not be read.
+	*/
+	Mat get(int i);
+
+	/*
+		Returns the full size of image i (read from the file header, before the reduced decoding).
+		It is valid after "get(i)".
+	*/
+	Size getOriginalSize(int i);
+
+	/*
+		Returns the size of the image in the file (from the JPEG/PNG header if possible, otherwise by decoding it).
+		Returns an empty size if the file can not be read.
+	*/
+	static Size readImageSize(const string& file_name);
+
+	/*
+		Reads the whole file into "bytes". Returns false if the file can not be read.
+	*/
+	static bool readFile(const string& file_name, vector<uchar>& bytes);
+
+	/*
+		Decodes the image at the reduced size chosen for "scale" and gives its full size.
+	*/
+	Mat decode(const vector<uchar>& bytes, Size& original_size);
+
+	/*
+		Stops the workers (the images which are not taken yet are dropped).
+	*/
+	void stop();
+
+private:
+	vector<String> names;
+	vector<Mat> frames;
+	vector<Size> originalSizes;
+	vector<bool> done;
+
+	// index of the next image to be read by a worker, number of images taken by the caller.
+	int next = 0;
+	int taken = 0;
+	bool stopping = false;
+
+	vector<thread> workers;
+	mutex lock;
+	condition_variable imageReady;
+	condition_variable spaceReady;
+
+	/*
+		Loop of a worker thread.
+	*/
+	void work();
+
+	/*
+		Reads the size of the image from the header of a JPEG (SOF marker) or PNG (IHDR) file.
+		Returns false for the other formats.
+	*/
+	static bool parseImageSize(const vector<uchar>& bytes, Size& size);
+};
+
+#endif
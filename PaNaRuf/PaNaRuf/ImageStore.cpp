@@ -0,0 +1,106 @@
+#include "ImageStore.h"
+
+void ImageStore::open(const vector<String>& image_names) {
+	lock_guard<mutex> guard(lock);
+	names = image_names;
+	compressed.assign(names.size(), vector<uchar>());
+	compressedBytes = 0;
+	cache.clear();
+	order.clear();
+	cachedBytes = 0;
+}
+
+Mat ImageStore::get(int i, double scale, Size& original_size) {
+	pair<int, double> key(i, scale);
+	{
+		lock_guard<mutex> guard(lock);
+		auto found = cache.find(key);
+		if (found != cache.end()) {
+			// moves the image to the front of the LRU order.
+			order.splice(order.begin(), order, found->second.position);
+			original_size = found->second.originalSize;
+			return found->second.image;
+		}
+	}
+
+	// decoding is done without the lock, so the other threads can decode other images at the same time.
+	Mat image = decode(i, scale, original_size);
+	if (image.empty())
+		return image;
+
+	lock_guard<mutex> guard(lock);
+	insert(key, image, original_size);
+	return image;
+}
+
+void ImageStore::release() {
+	lock_guard<mutex> guard(lock);
+	cache.clear();
+	order.clear();
+	cachedBytes = 0;
+}
+
+size_t ImageStore::getCachedBytes() {
+	lock_guard<mutex> guard(lock);
+	return cachedBytes;
+}
+
+Mat ImageStore::decode(int i, double scale, Size& original_size) {
+	vector<uchar> bytes;
+	{
+		lock_guard<mutex> guard(lock);
+		bytes = compressed[i];
+	}
+
+	if (bytes.empty()) {
+		if (!ImageLoader::readFile(names[i], bytes))
+			return Mat();
+
+		// keeps the file in memory if it fits in the budget.
+		lock_guard<mutex> guard(lock);
+		if (compressed[i].empty() && compressedBytes + bytes.size() <= compressedBudgetBytes) {
+			compressed[i] = bytes;
+			compressedBytes += bytes.size();
+		}
+	}
+
+	ImageLoader loader;
+	loader.scale = scale;
+	Mat image = loader.decode(bytes, original_size);
+	if (image.empty())
+		return image;
+
+	// the reduced decoding gives a size between the original size and "scale", the rest is a small resize.
+	Size size(max(1, cvRound(original_size.width * scale)), max(1, cvRound(original_size.height * scale)));
+	if (image.size() != size) {
+		Mat resized;
+		resize(image, resized, size, 0, 0, image.cols > size.width ? INTER_AREA : INTER_LINEAR_EXACT);
+		image = resized;
+	}
+	return image;
+}
+
+void ImageStore::insert(pair<int, double> key, const Mat& image, Size original_size) {
+	// another thread may have decoded the same image in the meantime.
+	if (cache.count(key))
+		return;
+
+	size_t bytes = image.total() * image.elemSize();
+	if (bytes > memoryCapBytes)
+		return;
+
+	while (!order.empty() && cachedBytes + bytes > memoryCapBytes) {
+		auto last = cache.find(order.back());
+		cachedBytes -= last->second.image.total() * last->second.image.elemSize();
+		cache.erase(last);
+		order.pop_back();
+	}
+
+	order.push_front(key);
+	Entry entry;
+	entry.image = image;
+	entry.originalSize = original_size;
+	entry.position = order.begin();
+	cache[key] = entry;
+	cachedBytes += bytes;
+}
@@ -0,0 +1,86 @@
+#ifndef  IMAGE_STORE_H
+#define  IMAGE_STORE_H
+
+#include <iostream>
+#include <list>
+#include <map>
+#include <mutex>
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+#include "ImageLoader.h"
+
+using namespace std;
+using namespace cv;
+
+/*
+	Keeps the input images in a compact form and decodes them only when a stage needs their pixels.
+
+	* Each image is a file reference. The compressed bytes of the file are kept in memory after the first read,
+	  as long as all of the kept files fit in "compressedBudgetBytes", so the next decodes do not wait for the disk.
+	* The decoded images (at a given scale of the original image) are kept in an LRU cache, and the least recently
+	  used ones are dropped when the decoded pixels exceed "memoryCapBytes".
+	* "release" drops all of the decoded pixels, it is called when a stage is done with the images.
+	  (an image given by "get" stays valid for its holder, the cache only drops its own reference)
+	"get" can be called from several threads.
+*/
+class ImageStore {
+
+public:
+	// Maximum size of the decoded images kept in the cache.
+	size_t memoryCapBytes = size_t(1024) * 1024 * 1024;
+
+	// Maximum total size of the compressed files kept in memory.
+	size_t compressedBudgetBytes = size_t(256) * 1024 * 1024;
+
+	/*
+		Sets the images of the store (file references only, nothing is read yet).
+	*/
+	void open(const vector<String>& image_names);
+
+	/*
+		Returns image i resized to "scale" of its original size (decoded at a reduced size when possible).
+		The original size of the image is given to "original_size".
+		Returns an empty Mat if the image could not be read.
+	*/
+	Mat get(int i, double scale, Size& original_size);
+
+	/*
+		Drops the decoded images (the compressed bytes are kept).
+	*/
+	void release();
+
+	/*
+		Total size of the decoded images in the cache.
+	*/
+	size_t getCachedBytes();
+
+private:
+	struct Entry {
+		Mat image;
+		Size originalSize;
+		list<pair<int, double>>::iterator position;
+	};
+
+	vector<String> names;
+	vector<vector<uchar>> compressed;
+	size_t compressedBytes = 0;
+
+	// decoded images by (image, scale), the most recently used one is at the front of "order".
+	map<pair<int, double>, Entry> cache;
+	list<pair<int, double>> order;
+	size_t cachedBytes = 0;
+
+	mutex lock;
+
+	/*
+		Reads and decodes image i (compressed bytes in memory or the file) without the lock.
+	*/
+	Mat decode(int i, double scale, Size& original_size);
+
+	/*
+		Adds a decoded image to the cache, dropping the least recently used ones to stay below the memory cap.
+	*/
+	void insert(pair<int, double> key, const Mat& image, Size original_size);
+};
+
+#endif
@@ -0,0 +1,72 @@
+#include "ImageWarper.h"
+
+void ImageWarper::estimateGains(PanoramaType type, const vector<Mat>& images, const vector<Mat>& Ks, const vector<Mat>& Rs) {
+	vector<Rect> rois(images.size());
+	for (int i = 0; i < images.size(); i++)
+		rois[i] = findRoi(type, images[i].size(), Ks[i], Rs[i]);
+
+	gainCompensator.estimate(images, rois, [&](int i, Rect area, WarpMap& warpMap) {
+		if (type == PERSPECTIVE)
+			warpMapper.buildPerspectiveMap(images[i].size(), area, Rs[i], warpMap);
+		else
+			warpMapper.buildMap(type, images[i].size(), area, Ks[i], Rs[i], warpMap);
+	});
+}
+
+void ImageWarper::warp(PanoramaType type, const vector<Size>& sourceSizes, const vector<Mat>& Ks, const vector<Mat>& Rs,
+	const function<Mat(int)>& loadImage, vector<Mat>& warped_images, vector<Mat>& warped_masks, vector<Point>& corners, vector<Size>& sizes) {
+	int count = (int)sourceSizes.size();
+
+	/*
+		Forward warping of all images is applied first (it is cheap), since the scheduler needs the size of each
+		warped image to decide which images are warped together. The loaded image is also in memory while it is warped.
+	*/
+	vector<Rect> rois(count);
+	vector<size_t> source_bytes(count);
+	for (int i = 0; i < count; i++) {
+		rois[i] = findRoi(type, sourceSizes[i], Ks[i], Rs[i]);
+		source_bytes[i] = size_t(sourceSizes[i].area()) * 3;
+	}
+
+	/*
+		Apply backward mapping, several images are warped at the same time.
+		(the border-reflect effect around the image, which we need for multi-band blending,
+		is given by the sampler, the reflected images are not created)
+	*/
+	vector<Mat> all_warped_images(count), all_warped_masks(count);
+	int counter = 0;
+	warpScheduler.run(rois, source_bytes, [&](int i) {
+#pragma omp critical(output)
+		cout << "Warping " << ++counter << "/" << count << " (" << rois[i].width << "x" << rois[i].height << ")" << endl;
+
+		Mat image = loadImage(i);
+		if (image.empty())
+			return;
+		WarpMap warpMap = warpMapper.getMap(type, image.size(), rois[i], Ks[i], Rs[i]);
+		warpMapper.apply(image, warpMap, all_warped_images[i], all_warped_masks[i], gainCompensator.getGainMap(i));
+	});
+
+	for (int i = 0; i < count; i++) {
+		if (rois[i].empty() || all_warped_images[i].empty())
+			continue;
+
+		/*
+			After finding the top-left corner point of each warped image along with its size,
+			we keep track of each of those data which we need in applying multi-band blending.
+		*/
+		corners.push_back(rois[i].tl());
+		sizes.push_back(rois[i].size());
+		warped_images.push_back(all_warped_images[i]);
+		warped_masks.push_back(all_warped_masks[i]);
+	}
+}
+
+Rect ImageWarper::findRoi(PanoramaType type, Size imageSize, Mat K, Mat R) {
+	try {
+		return warpMapper.findRoi(type, imageSize, type == PERSPECTIVE ? Mat() : K, R);
+	}
+	catch (exception e) {
+		cout << "A problem occured. Probably, the area of the destination image is too big! (overflow/infinity)" << endl;
+		return Rect();
+	}
+}
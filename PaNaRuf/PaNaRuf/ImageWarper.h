@@ -0,0 +1,58 @@
+#ifndef  IMAGE_WARPER_H
+#define  IMAGE_WARPER_H
+
+#include <iostream>
+#include <functional>
+#include <omp.h>
+#include <opencv2/core.hpp>
+#include "PanoramaType.h"
+#include "WarpMapper.h"
+#include "WarpScheduler.h"
+#include "GainCompensator.h"
+
+using namespace std;
+using namespace cv;
+
+/*
+	Warps the images of a panorama with the same steps for all of the panorama types:
+	* The exposure gains are estimated from the overlaps of the work images (estimateGains).
+	* The destination area of each image is found with the forward warping (only the border is projected).
+	* The scheduler decides which images are warped at the same time. Each image is loaded just before it is
+	  warped, and the backward map (computed once, or taken from the cache) is applied with the gains.
+	For PERSPECTIVE, the camera matrices are not used and the rotations are the homography matrices of the images.
+*/
+class ImageWarper {
+
+public:
+	// Computes, caches and applies the backward warp maps.
+	WarpMapper warpMapper;
+
+	// Decides which images are warped at the same time.
+	WarpScheduler warpScheduler;
+
+	// Estimates the exposure gains of the images (applied during the backward warping).
+	GainCompensator gainCompensator;
+
+	/*
+		Estimates the gain map of each image from the images used for the registration.
+		A gain map is relative to the size of its warped image, so it is also valid at the compose scale.
+	*/
+	void estimateGains(PanoramaType type, const vector<Mat>& images, const vector<Mat>& Ks, const vector<Mat>& Rs);
+
+	/*
+		Warps the images and gives the warped images, masks, top-left corners and sizes of the visible ones.
+		* sourceSizes -> sizes of the images which "loadImage" gives (the compose scale).
+		* loadImage(i) -> returns image i, it is called from several threads. An image which can not be loaded
+		  (empty Mat) is not in the outputs.
+	*/
+	void warp(PanoramaType type, const vector<Size>& sourceSizes, const vector<Mat>& Ks, const vector<Mat>& Rs,
+		const function<Mat(int)>& loadImage, vector<Mat>& warped_images, vector<Mat>& warped_masks, vector<Point>& corners, vector<Size>& sizes);
+
+private:
+	/*
+		Forward warping, an empty area if the destination image is too big (overflow/infinity).
+	*/
+	Rect findRoi(PanoramaType type, Size imageSize, Mat K, Mat R);
+};
+
+#endif
@@ -53,21 +53,35 @@ int main(int argc, char* argv[])
 
 
 	
+	/*
+		Reading optional settings given after the mandatory arguments.
+		(spherical panorama has 2 more mandatory arguments: hfov and vfov)
+	*/
+	PanoramaOptions options;
+	int firstOption = (panoType == SPHERICAL) ? 5 : 3;
+	if (panoType != NONE && argc >= firstOption && !input_output.readOptions(argc, argv, firstOption, options)) {
+		input_output.provideCorrectInputError();
+		return -1;
+	}
+
 	if (panoType == PERSPECTIVE) {
 			CustomPerspectiveWarping perspectiveWarping;
+			perspectiveWarping.options = options;
 			perspectiveWarping.applyCustomPerspectiveWarping(image_names);
 	}
 	else if (panoType == CYLINDRICAL) {
 		CustomCylindricalPanorama cylindricalPanorama;
+		cylindricalPanorama.options = options;
 		cylindricalPanorama.applyCustomCylindricalWarping(image_names);
 	}
 
 	else if (panoType == SPHERICAL) {
-		if (argc == 5) {
+		if (argc >= 5) {
 			try {
 				double hfov = stod(argv[3]);
 				double vfov = stod(argv[4]);
 				CustomSphericalPanorama sphericalPanorama;
+				sphericalPanorama.options = options;
 				sphericalPanorama.applyCustomSphericalWarping(image_names, hfov, vfov);
 			}
 			catch(exception e){
@@ -0,0 +1,85 @@
+#include "OutputWriter.h"
+
+bool MatWriter::open(Size size) {
+	result = Mat(size, CV_8UC3);
+	row = 0;
+	return true;
+}
+
+void MatWriter::writeRows(const Mat& band) {
+	band.copyTo(result.rowRange(row, row + band.rows));
+	row += band.rows;
+}
+
+void MatWriter::close() {
+}
+
+PpmWriter::PpmWriter(string file_name) {
+	this->file_name = file_name;
+}
+
+bool PpmWriter::open(Size size) {
+	failed = false;
+	file.open(file_name, ios::out | ios::binary);
+	if (!file.is_open())
+		return false;
+	file << "P6\n" << size.width << " " << size.height << "\n255\n";
+	return file.good();
+}
+
+void PpmWriter::writeRows(const Mat& band) {
+	// PPM stores the pixels in RGB order.
+	vector<uchar> row(band.cols * 3);
+	for (int y = 0; y < band.rows; y++) {
+		const uchar* src = band.ptr<uchar>(y);
+		for (int x = 0; x < band.cols; x++) {
+			row[3 * x] = src[3 * x + 2];
+			row[3 * x + 1] = src[3 * x + 1];
+			row[3 * x + 2] = src[3 * x];
+		}
+		file.write((const char*)row.data(), row.size());
+	}
+	if (!file.good())
+		failed = true;
+}
+
+void PpmWriter::close() {
+	// the buffered rows are written by the close, so it can fail too.
+	file.close();
+	if (file.fail())
+		failed = true;
+}
+
+bool PpmWriter::good() {
+	return !failed;
+}
+
+void MultiWriter::add(OutputWriter* writer) {
+	writers.push_back(writer);
+}
+
+bool MultiWriter::open(Size size) {
+	for (int i = 0; i < writers.size(); i++) {
+		if (!writers[i]->open(size))
+			return false;
+	}
+	return true;
+}
+
+void MultiWriter::writeRows(const Mat& band) {
+	for (int i = 0; i < writers.size(); i++)
+		writers[i]->writeRows(band);
+}
+
+void MultiWriter::close() {
+	for (int i = 0; i < writers.size(); i++)
+		writers[i]->close();
+}
+
+bool MultiWriter::good() {
+	for (int i = 0; i < writers.size(); i++) {
+		if (!writers[i]->good())
+			return false;
+	}
+	return true;
+}
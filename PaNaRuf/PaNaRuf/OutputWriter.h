@@ -0,0 +1,104 @@
+#ifndef  OUTPUT_WRITER_H
+#define  OUTPUT_WRITER_H
+
+#include <iostream>
+#include <fstream>
+#include <opencv2/core.hpp>
+
+using namespace std;
+using namespace cv;
+
+/*
+	Destination of a panorama rendered band by band (see TiledRenderer).
+	The bands (CV_8UC3, full width of the panorama) are given from top to bottom,
+	so the whole panorama never has to be in memory.
+*/
+class OutputWriter {
+
+public:
+	virtual ~OutputWriter() {}
+
+	/*
+		Prepares the output for a panorama of the given size. Returns false if it can not be created.
+	*/
+	virtual bool open(Size size) = 0;
+
+	/*
+		Writes the next band of rows.
+	*/
+	virtual void writeRows(const Mat& band) = 0;
+
+	virtual void close() = 0;
+
+	/*
+		Returns false if some of the rows could not be written (e.g. the disk is full).
+	*/
+	virtual bool good() { return true; }
+};
+
+/*
+	Collects the bands in "result" (used when the panorama fits in memory).
+*/
+class MatWriter : public OutputWriter {
+
+public:
+	Mat result;
+
+	bool open(Size size);
+
+	void writeRows(const Mat& band);
+
+	void close();
+
+private:
+	// the first row of the next band.
+	int row = 0;
+};
+
+/*
+	Writes the panorama to a binary PPM (P6) file, row by row.
+	(PPM has no size limit and needs no codec, so it can hold panoramas larger than the memory)
+*/
+class PpmWriter : public OutputWriter {
+
+public:
+	PpmWriter(string file_name);
+
+	bool open(Size size);
+
+	void writeRows(const Mat& band);
+
+	void close();
+
+	bool good();
+
+private:
+	string file_name;
+	ofstream file;
+
+	// the stream failed while it was written or closed.
+	bool failed = false;
+};
+
+/*
+	Gives the same bands to several writers (e.g. a PPM file and a tile pyramid).
+	The writers are not owned.
+*/
+class MultiWriter : public OutputWriter {
+
+public:
+	void add(OutputWriter* writer);
+
+	bool open(Size size);
+
+	void writeRows(const Mat& band);
+
+	void close();
+
+	bool good();
+
+private:
+	vector<OutputWriter*> writers;
+};
+
+#endif
@@ -0,0 +1,46 @@
+#ifndef  PANORAMA_OPTIONS_H
+#define  PANORAMA_OPTIONS_H
+
+#include <string>
+#include "PanoramaType.h"
+#include "SeamFinderType.h"
+#include "ExposureCompensationType.h"
+
+using namespace std;
+
+/*
+	Optional settings given by the user after the mandatory arguments (e.g. "-maps <dir>").
+	Each of the warping algorithms keeps a copy of these options and reads them during the execution.
+	* mapsDirectory -> if it is not empty, the warp maps are saved to/loaded from this directory,
+	  so a fixed rig only pays the geometry cost once.
+	* directFisheye -> (spherical only) the spherical image points are mapped straight to the fisheye images,
+	  the rectilinear images are only used to find the relations among the fisheye images.
+	  The panorama is always equirectangular and blended in memory (no projection, tiledOutput, feather or exposure).
+	* projection -> (cylindrical and spherical) projection of the panorama instead of the default one of the chosen type
+	  (cylindrical, spherical, planar, stereographic, mercator or equisolid). NONE keeps the default.
+	* tiledOutput -> if it is not empty, the panorama is rendered tile by tile and written to this (PPM) file
+	  instead of being blended in memory (see TiledRenderer).
+	* feather -> the images are composited with feathering while they are warped (see TiledRenderer), without the
+	  warped images, the seam finding and the multi-band blending. Faster, for previews.
+	* exposure -> exposure compensation of the images, applied while they are warped or composited (none by default).
+	* seamFinder, seamMegapix -> algorithm and resolution (megapixels of the largest warped image) of the seam finding.
+	* composeMegapix -> (perspective and cylindrical) resolution of the panorama, in megapixels of an input image.
+	  The images are still registered at the low work scale. 0 (default) composes at the work scale too,
+	  negative values compose at the original resolution.
+	* dziOutput -> if it is not empty, the panorama is written as a Deep Zoom tile pyramid (<name>.dzi and <name>_files)
+	  straight from the blender, instead of the output image.
+*/
+struct PanoramaOptions {
+	string mapsDirectory = "";
+	bool directFisheye = false;
+	PanoramaType projection = NONE;
+	string tiledOutput = "";
+	bool feather = false;
+	ExposureCompensationType exposure = NO_EXPOSURE_COMPENSATION;
+	SeamFinderType seamFinder = GRAPH_CUT_SEAM;
+	double seamMegapix = 0.1;
+	double composeMegapix = 0;
+	string dziOutput = "";
+};
+
+#endif
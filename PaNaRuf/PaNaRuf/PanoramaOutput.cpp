@@ -0,0 +1,52 @@
+#include "PanoramaOutput.h"
+
+PanoramaOutput::PanoramaOutput(PanoramaType type, const PanoramaOptions& options) {
+	this->type = type;
+	this->options = options;
+
+	if (!options.tiledOutput.empty()) {
+		ppmWriter.reset(new PpmWriter(options.tiledOutput));
+		writers.add(ppmWriter.get());
+	}
+	if (!options.dziOutput.empty()) {
+		deepZoomWriter.reset(new DeepZoomWriter(options.dziOutput));
+		writers.add(deepZoomWriter.get());
+	}
+	if (isInMemory())
+		writers.add(&matWriter);
+}
+
+OutputWriter& PanoramaOutput::getWriter() {
+	if (ppmWriter)
+		input_output.StartTiledRendering(options.tiledOutput);
+	if (deepZoomWriter)
+		input_output.StartWritingTilePyramid(options.dziOutput);
+	return writers;
+}
+
+bool PanoramaOutput::isInMemory() {
+	return !ppmWriter && !deepZoomWriter;
+}
+
+void PanoramaOutput::finish(bool written) {
+	if (isInMemory()) {
+		if (written)
+			input_output.prepareOutputImage(type, matWriter.result);
+		return;
+	}
+
+	if (written)
+		return;
+
+	// the file which failed is reported, or all of the files if the panorama could not be created at all.
+	bool ppm_failed = ppmWriter && !ppmWriter->good();
+	bool dzi_failed = deepZoomWriter && !deepZoomWriter->good();
+	if (!ppm_failed && !dzi_failed) {
+		ppm_failed = (bool)ppmWriter;
+		dzi_failed = (bool)deepZoomWriter;
+	}
+	if (ppm_failed)
+		input_output.tiledOutputError(options.tiledOutput);
+	if (dzi_failed)
+		input_output.tiledOutputError(options.dziOutput);
+}
@@ -0,0 +1,61 @@
+#ifndef  PANORAMA_OUTPUT_H
+#define  PANORAMA_OUTPUT_H
+
+#include <iostream>
+#include <memory>
+#include <opencv2/core.hpp>
+#include "OutputWriter.h"
+#include "DeepZoomWriter.h"
+#include "PanoramaOptions.h"
+#include "PanoramaType.h"
+#include "IO.h"
+
+using namespace std;
+using namespace cv;
+
+/*
+	Destination of the rows of a panorama, chosen from the options in the same way for all panoramas
+	(after the multi-band blending and after the tiled/feather rendering):
+	* "-tiled <file.ppm>" -> the rows are streamed to a PPM file (PpmWriter).
+	* "-dzi <name>" -> the rows are streamed to a Deep Zoom tile pyramid (DeepZoomWriter).
+	  Both can be given, then the rows go to both of them.
+	* otherwise -> the panorama is collected in memory and written as the output image of the panorama type.
+*/
+class PanoramaOutput {
+
+public:
+	/*
+		* type -> selects the output image when the panorama is kept in memory.
+	*/
+	PanoramaOutput(PanoramaType type, const PanoramaOptions& options);
+
+	/*
+		Prints the outputs which will be written and returns the writer which takes the rows.
+	*/
+	OutputWriter& getWriter();
+
+	/*
+		Returns true if the panorama is kept in memory (no "-tiled" or "-dzi" file).
+	*/
+	bool isInMemory();
+
+	/*
+		Called when the panorama is done ("written" -> result of the blender or of the renderer).
+		Reports the outputs which could not be written, or writes the output image.
+	*/
+	void finish(bool written);
+
+private:
+	PanoramaType type;
+	PanoramaOptions options;
+
+	// Prints the messages.
+	IO input_output;
+
+	unique_ptr<PpmWriter> ppmWriter;
+	unique_ptr<DeepZoomWriter> deepZoomWriter;
+	MatWriter matWriter;
+	MultiWriter writers;
+};
+
+#endif
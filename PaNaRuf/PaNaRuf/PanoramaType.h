@@ -4,7 +4,9 @@
 /*
 	Since, our software can create spherical, cylindrical and perspective warping,
 	we use the below enum "PanoramaType" to categorize them based on the chosen input.
+	The camera based panoramas can also be projected to a plane (PLANAR), or with
+	stereographic, Mercator and equisolid fisheye projections (see Projections.h).
 */
-enum PanoramaType { PERSPECTIVE, CYLINDRICAL, SPHERICAL , NONE };
+enum PanoramaType { PERSPECTIVE, CYLINDRICAL, SPHERICAL , PLANAR, STEREOGRAPHIC, MERCATOR, EQUISOLID, NONE };
 
 #endif 
\ No newline at end of file
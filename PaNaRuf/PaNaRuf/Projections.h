@@ -0,0 +1,187 @@
+#ifndef  PROJECTIONS_H
+#define  PROJECTIONS_H
+
+#include <iostream>
+#include <cmath>
+#include <opencv2/core.hpp>
+#include "FastMath.h"
+
+using namespace std;
+
+/*
+	Projection policies of the warp engine (see WarpEngine).
+	A destination point (x, y) is given in normalized coordinates (divided by the focal lengths)
+	and a ray is a 3D direction in the panorama frame (it can have any positive scale).
+
+	Each policy gives:
+	* separable -> if it is true, the ray of (x, y) is (s(x) * a(y), b(y), c(x) * a(y)):
+	  columns(x, s, c, n) gives s and c of n columns, row(y, a, b) gives a and b of a row,
+	  so the engine only needs the vectorized row kernels.
+	  Otherwise, unproject(x, y, X, Y, Z) gives the ray of each point (false if the point has no ray).
+	* project(X, Y, Z, x, y) -> forward mapping of a ray, returns false if the ray is outside of
+	  the domain of the projection (e.g. behind a planar image).
+*/
+
+/*
+	theta = x, height = y on the unit cylinder.
+*/
+struct CylindricalProjection {
+	static const bool separable = true;
+
+	static void columns(const float* x, float* s, float* c, int n) {
+		FastMath::sinCos(x, s, c, n);
+	}
+
+	static inline void row(double y, double& a, double& b) {
+		a = 1.0;
+		b = y;
+	}
+
+	static inline bool project(double X, double Y, double Z, double& x, double& y) {
+		double d = sqrt(X * X + Z * Z);
+		if (d == 0)
+			return false;
+		x = FastMath::atan2((float)X, (float)Z);
+		y = Y / d;
+		return true;
+	}
+};
+
+/*
+	Equirectangular : longitude theta = x, latitude phi = y on the unit sphere.
+*/
+struct SphericalProjection {
+	static const bool separable = true;
+
+	static void columns(const float* x, float* s, float* c, int n) {
+		FastMath::sinCos(x, s, c, n);
+	}
+
+	static inline void row(double y, double& a, double& b) {
+		a = cos(y);
+		b = sin(y);
+	}
+
+	static inline bool project(double X, double Y, double Z, double& x, double& y) {
+		double d = sqrt(X * X + Z * Z);
+		x = FastMath::atan2((float)X, (float)Z);
+		y = FastMath::atan2((float)Y, (float)d);
+		return true;
+	}
+};
+
+/*
+	Mercator : longitude theta = x, latitude phi = atan(sinh(y)).
+	The latitudes are limited to about +-85 degrees (|y| <= pi), since the poles are at infinity.
+*/
+struct MercatorProjection {
+	static const bool separable = true;
+
+	static void columns(const float* x, float* s, float* c, int n) {
+		FastMath::sinCos(x, s, c, n);
+	}
+
+	// cos(phi) = 1 / cosh(y), sin(phi) = tanh(y)
+	static inline void row(double y, double& a, double& b) {
+		a = 1.0 / cosh(y);
+		b = tanh(y);
+	}
+
+	static inline bool project(double X, double Y, double Z, double& x, double& y) {
+		double d = sqrt(X * X + Z * Z);
+		if (d == 0)
+			return false;
+		x = FastMath::atan2((float)X, (float)Z);
+		y = asinh(Y / d);
+		return fabs(y) <= CV_PI;
+	}
+};
+
+/*
+	Planar (rectilinear) image at distance 1 : the ray of (x, y) is (x, y, 1).
+	Only the rays within about 84 degrees of the optical axis are projected.
+*/
+struct PlanarProjection {
+	static const bool separable = true;
+
+	static void columns(const float* x, float* s, float* c, int n) {
+		for (int i = 0; i < n; i++) {
+			s[i] = x[i];
+			c[i] = 1.0f;
+		}
+	}
+
+	static inline void row(double y, double& a, double& b) {
+		a = 1.0;
+		b = y;
+	}
+
+	static inline bool project(double X, double Y, double Z, double& x, double& y) {
+		if (Z <= 0.1 * sqrt(X * X + Y * Y + Z * Z))
+			return false;
+		x = X / Z;
+		y = Y / Z;
+		return true;
+	}
+};
+
+/*
+	Stereographic : r = 2 * tan(alpha / 2), where alpha is the angle from the optical axis.
+	The ray of (x, y) is (x, y, 1 - r^2 / 4) (no trigonometry is needed).
+	Only the rays within about 143 degrees of the optical axis are projected, since the opposite point is at infinity.
+*/
+struct StereographicProjection {
+	static const bool separable = false;
+
+	static inline bool unproject(float x, float y, float& X, float& Y, float& Z) {
+		X = x;
+		Y = y;
+		Z = 1.0f - 0.25f * (x * x + y * y);
+		return true;
+	}
+
+	static inline bool project(double X, double Y, double Z, double& x, double& y) {
+		double n = sqrt(X * X + Y * Y + Z * Z);
+		if (Z <= -0.8 * n)
+			return false;
+		x = 2.0 * X / (n + Z);
+		y = 2.0 * Y / (n + Z);
+		return true;
+	}
+};
+
+/*
+	Equisolid-angle fisheye : r = 2 * sin(alpha / 2), where alpha is the angle from the optical axis.
+	The ray of (x, y) is (x * sqrt(1 - r^2 / 4), y * sqrt(1 - r^2 / 4), 1 - r^2 / 2), the points with r > 2 have no ray.
+*/
+struct EquisolidProjection {
+	static const bool separable = false;
+
+	static inline bool unproject(float x, float y, float& X, float& Y, float& Z) {
+		float r2 = x * x + y * y;
+		if (r2 > 4.0f)
+			return false;
+		float k = sqrt(1.0f - 0.25f * r2);
+		X = x * k;
+		Y = y * k;
+		Z = 1.0f - 0.5f * r2;
+		return true;
+	}
+
+	static inline bool project(double X, double Y, double Z, double& x, double& y) {
+		double n = sqrt(X * X + Y * Y + Z * Z);
+		double rho = sqrt(X * X + Y * Y);
+		if (Z <= -0.95 * n)
+			return false;
+		if (rho == 0) {
+			x = y = 0;
+			return true;
+		}
+		double r = sqrt(2.0 * (1.0 - Z / n));
+		x = r * X / rho;
+		y = r * Y / rho;
+		return true;
+	}
+};
+
+#endif
@@ -0,0 +1,229 @@
+#include "PyramidKernels.h"
+
+#if defined(_M_X64) || defined(__x86_64__) || defined(_M_IX86) || defined(__i386__)
+#define PANARUF_X86
+#include <immintrin.h>
+#endif
+
+// AVX2 functions are compiled for AVX2 only, they are called after checking the CPU (see WarpKernels.cpp).
+#if defined(__GNUC__) || defined(__clang__)
+#define PANARUF_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define PANARUF_TARGET_AVX2
+#endif
+
+/*
+	Index of the row/column read for index i of a level of n rows/columns (BORDER_REFLECT_101).
+*/
+static inline int reflect101(int i, int n) {
+	if (n == 1)
+		return 0;
+	while (i < 0 || i >= n)
+		i = i < 0 ? -i : 2 * n - 2 - i;
+	return i;
+}
+
+/*
+	Vertical pass of pyrDown : t = r0 + 4 * r1 + 6 * r2 + 4 * r3 + r4.
+	Returns the number of values computed with AVX2.
+*/
+#ifdef PANARUF_X86
+PANARUF_TARGET_AVX2
+static int verticalDownAVX2(const short* r0, const short* r1, const short* r2, const short* r3, const short* r4, int n, int* t) {
+	int i = 0;
+	for (; i <= n - 8; i += 8) {
+		__m256i a = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i*)(r0 + i)));
+		__m256i b = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i*)(r1 + i)));
+		__m256i c = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i*)(r2 + i)));
+		__m256i d = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i*)(r3 + i)));
+		__m256i e = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i*)(r4 + i)));
+		__m256i sum = _mm256_add_epi32(a, e);
+		sum = _mm256_add_epi32(sum, _mm256_slli_epi32(_mm256_add_epi32(b, d), 2));
+		sum = _mm256_add_epi32(sum, _mm256_add_epi32(_mm256_slli_epi32(c, 2), _mm256_slli_epi32(c, 1)));
+		_mm256_storeu_si256((__m256i*)(t + i), sum);
+	}
+	return i;
+}
+
+/*
+	Vertical pass of pyrUp for an even (t = r0 + 6 * r1 + r2) or an odd (t = 4 * (r1 + r2)) destination row.
+*/
+PANARUF_TARGET_AVX2
+static int verticalUpAVX2(const short* r0, const short* r1, const short* r2, bool even, int n, int* t) {
+	int i = 0;
+	for (; i <= n - 8; i += 8) {
+		__m256i b = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i*)(r1 + i)));
+		__m256i c = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i*)(r2 + i)));
+		__m256i sum;
+		if (even) {
+			__m256i a = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i*)(r0 + i)));
+			sum = _mm256_add_epi32(_mm256_add_epi32(a, c), _mm256_add_epi32(_mm256_slli_epi32(b, 2), _mm256_slli_epi32(b, 1)));
+		}
+		else
+			sum = _mm256_slli_epi32(_mm256_add_epi32(b, c), 2);
+		_mm256_storeu_si256((__m256i*)(t + i), sum);
+	}
+	return i;
+}
+
+/*
+	dst += lap * w3 and dst_w += w for a row, w3 is the weight of each value (the weight of the pixel repeated for each channel).
+*/
+PANARUF_TARGET_AVX2
+static int accumulateAVX2(const short* lap, const int* w3, int n, int* dst) {
+	int i = 0;
+	for (; i <= n - 8; i += 8) {
+		__m256i l = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i*)(lap + i)));
+		__m256i w = _mm256_loadu_si256((const __m256i*)(w3 + i));
+		__m256i d = _mm256_loadu_si256((const __m256i*)(dst + i));
+		_mm256_storeu_si256((__m256i*)(dst + i), _mm256_add_epi32(d, _mm256_mullo_epi32(l, w)));
+	}
+	return i;
+}
+#endif
+
+void PyramidKernels::pyrDown(const Mat& src, Mat& dst) {
+	int cn = src.channels();
+	dst.create((src.rows + 1) / 2, (src.cols + 1) / 2, src.type());
+	int n = src.cols * cn;
+	bool avx2 = false;
+#ifdef PANARUF_X86
+	avx2 = checkHardwareSupport(CV_CPU_AVX2);
+#endif
+
+#pragma omp parallel if (dst.rows >= 64)
+	{
+		vector<int> t(n);
+#pragma omp for
+		for (int y = 0; y < dst.rows; y++) {
+			const short* r[5];
+			for (int k = 0; k < 5; k++)
+				r[k] = src.ptr<short>(reflect101(2 * y - 2 + k, src.rows));
+
+			int i = 0;
+#ifdef PANARUF_X86
+			if (avx2)
+				i = verticalDownAVX2(r[0], r[1], r[2], r[3], r[4], n, t.data());
+#endif
+			for (; i < n; i++)
+				t[i] = r[0][i] + r[4][i] + 4 * (r[1][i] + r[3][i]) + 6 * r[2][i];
+
+			// horizontal pass with downsampling, the columns at the borders are reflected.
+			short* d = dst.ptr<short>(y);
+			for (int x = 0; x < dst.cols; x++) {
+				int c0 = 2 * x - 2, c4 = 2 * x + 2;
+				if (c0 >= 0 && c4 < src.cols) {
+					const int* p = t.data() + c0 * cn;
+					for (int c = 0; c < cn; c++)
+						d[x * cn + c] = (short)((p[c] + p[4 * cn + c] + 4 * (p[cn + c] + p[3 * cn + c]) + 6 * p[2 * cn + c] + 128) >> 8);
+				}
+				else {
+					int cols[5];
+					for (int k = 0; k < 5; k++)
+						cols[k] = reflect101(c0 + k, src.cols) * cn;
+					for (int c = 0; c < cn; c++)
+						d[x * cn + c] = (short)((t[cols[0] + c] + t[cols[4] + c] + 4 * (t[cols[1] + c] + t[cols[3] + c]) + 6 * t[cols[2] + c] + 128) >> 8);
+				}
+			}
+		}
+	}
+}
+
+void PyramidKernels::pyrUpAdd(const Mat& src, Mat& dst, int sign) {
+	int cn = src.channels();
+	int n = src.cols * cn;
+	bool avx2 = false;
+#ifdef PANARUF_X86
+	avx2 = checkHardwareSupport(CV_CPU_AVX2);
+#endif
+
+	/*
+		Each source row gives an even and an odd destination row. The source rows beyond the last one
+		are replaced by the last one (the upsampled image is reflected around its last row).
+	*/
+#pragma omp parallel if (dst.rows >= 64)
+	{
+		vector<int> t(n);
+#pragma omp for
+		for (int y = 0; y < dst.rows; y++) {
+			int sy = y / 2;
+			bool even = (y % 2) == 0;
+			const short* r0 = src.ptr<short>(sy > 0 ? sy - 1 : min(1, src.rows - 1));
+			const short* r1 = src.ptr<short>(sy);
+			const short* r2 = src.ptr<short>(min(sy + 1, src.rows - 1));
+
+			int i = 0;
+#ifdef PANARUF_X86
+			if (avx2)
+				i = verticalUpAVX2(r0, r1, r2, even, n, t.data());
+#endif
+			for (; i < n; i++)
+				t[i] = even ? r0[i] + 6 * r1[i] + r2[i] : 4 * (r1[i] + r2[i]);
+
+			// horizontal pass with upsampling.
+			short* d = dst.ptr<short>(y);
+			for (int x = 0; x < dst.cols; x++) {
+				int sx = x / 2;
+				int left = (sx > 0 ? sx - 1 : min(1, src.cols - 1)) * cn;
+				int center = sx * cn;
+				int right = min(sx + 1, src.cols - 1) * cn;
+				for (int c = 0; c < cn; c++) {
+					int sum = (x % 2) == 0 ? t[left + c] + 6 * t[center + c] + t[right + c] : 4 * (t[center + c] + t[right + c]);
+					d[x * cn + c] = saturate_cast<short>(d[x * cn + c] + sign * ((sum + 32) >> 6));
+				}
+			}
+		}
+	}
+}
+
+void PyramidKernels::accumulate(const Mat& lap, const Mat& weight, Mat& dst, Mat& dst_weight, Point offset) {
+	int cn = lap.channels();
+	int n = lap.cols * cn;
+	bool avx2 = false;
+#ifdef PANARUF_X86
+	avx2 = checkHardwareSupport(CV_CPU_AVX2);
+#endif
+
+#pragma omp parallel if (lap.rows >= 64)
+	{
+		vector<int> w3(n);
+#pragma omp for
+		for (int y = 0; y < lap.rows; y++) {
+			const short* l = lap.ptr<short>(y);
+			const short* w = weight.ptr<short>(y);
+			int* d = dst.ptr<int>(offset.y + y) + offset.x * cn;
+			int* dw = dst_weight.ptr<int>(offset.y + y) + offset.x;
+
+			for (int x = 0; x < lap.cols; x++) {
+				dw[x] += w[x];
+				for (int c = 0; c < cn; c++)
+					w3[x * cn + c] = w[x];
+			}
+
+			int i = 0;
+#ifdef PANARUF_X86
+			if (avx2)
+				i = accumulateAVX2(l, w3.data(), n, d);
+#endif
+			for (; i < n; i++)
+				d[i] += l[i] * w3[i];
+		}
+	}
+}
+
+void PyramidKernels::normalize(const Mat& sum, const Mat& weight, Mat& dst) {
+	int cn = sum.channels();
+	dst.create(sum.size(), CV_MAKETYPE(CV_16S, cn));
+
+#pragma omp parallel for if (sum.rows >= 64)
+	for (int y = 0; y < sum.rows; y++) {
+		const int* s = sum.ptr<int>(y);
+		const int* w = weight.ptr<int>(y);
+		short* d = dst.ptr<short>(y);
+		for (int x = 0; x < sum.cols; x++) {
+			float inv = w[x] > 0 ? 1.0f / w[x] : 0.0f;
+			for (int c = 0; c < cn; c++)
+				d[x * cn + c] = saturate_cast<short>(s[x * cn + c] * inv);
+		}
+	}
+}
@@ -0,0 +1,52 @@
+#ifndef  PYRAMID_KERNELS_H
+#define  PYRAMID_KERNELS_H
+
+#include <iostream>
+#include <omp.h>
+#include <opencv2/core.hpp>
+
+using namespace std;
+using namespace cv;
+
+/*
+	Fixed-point kernels of the Laplacian pyramids of the multi-band blending.
+
+	* The images and the Laplacian levels are int16 (CV_16SC3), the weights are int16 in [0, 256] (CV_16SC1).
+	* The weighted sums of the levels are accumulated in int32 (CV_32SC3, CV_32SC1) and normalized back to int16.
+	* pyrDown / pyrUp use the 5-tap binomial filter (1 4 6 4 1) with the same borders as OpenCV's pyrDown / pyrUp.
+	  The vertical pass of a destination row is computed in int32 with AVX2 (8 values at a time) and directly followed
+	  by the horizontal pass with the downsampling (or upsampling), so no intermediate image is created.
+	* The rows of a level are processed in parallel (if the caller is not already running in parallel).
+*/
+class PyramidKernels {
+
+public:
+	/*
+		Weight of a fully covered pixel.
+	*/
+	static const int WEIGHT_ONE = 256;
+
+	/*
+		Blurs and downsamples src (CV_16SC1 or CV_16SC3) into dst ((cols + 1) / 2 x (rows + 1) / 2).
+	*/
+	void pyrDown(const Mat& src, Mat& dst);
+
+	/*
+		Upsamples and blurs src and adds it to dst (sign = 1) or subtracts it from dst (sign = -1).
+		dst must be twice the size of src (CV_16SC1 or CV_16SC3).
+		With sign = -1 a Gaussian level becomes a Laplacian level, with sign = 1 a pyramid is collapsed.
+	*/
+	void pyrUpAdd(const Mat& src, Mat& dst, int sign);
+
+	/*
+		dst(offset + p) += lap(p) * weight(p) and dst_weight(offset + p) += weight(p) for each pixel p of lap.
+	*/
+	void accumulate(const Mat& lap, const Mat& weight, Mat& dst, Mat& dst_weight, Point offset);
+
+	/*
+		dst = sum / weight (0 where the weight is 0).
+	*/
+	void normalize(const Mat& sum, const Mat& weight, Mat& dst);
+};
+
+#endif
@@ -0,0 +1,76 @@
+#include "RoiIndex.h"
+
+void RoiIndex::build(const vector<Rect>& rois) {
+	this->rois = rois;
+
+	canvas = Rect();
+	for (int i = 0; i < rois.size(); i++) {
+		if (rois[i].empty())
+			continue;
+		canvas = canvas.empty() ? rois[i] : (canvas | rois[i]);
+	}
+
+	cols = canvas.empty() ? 0 : (canvas.width + cellSize - 1) / cellSize;
+	rows = canvas.empty() ? 0 : (canvas.height + cellSize - 1) / cellSize;
+	cells.assign(cols * rows, vector<int>());
+
+	// each roi is added to the cells it covers.
+	for (int i = 0; i < rois.size(); i++) {
+		if (rois[i].empty())
+			continue;
+		int c0 = (rois[i].x - canvas.x) / cellSize;
+		int c1 = (rois[i].br().x - 1 - canvas.x) / cellSize;
+		int r0 = (rois[i].y - canvas.y) / cellSize;
+		int r1 = (rois[i].br().y - 1 - canvas.y) / cellSize;
+		for (int r = r0; r <= r1; r++)
+			for (int c = c0; c <= c1; c++)
+				cells[r * cols + c].push_back(i);
+	}
+}
+
+void RoiIndex::query(Rect area, vector<int>& indices) const {
+	area &= canvas;
+	if (area.empty())
+		return;
+
+	int c0 = (area.x - canvas.x) / cellSize;
+	int c1 = (area.br().x - 1 - canvas.x) / cellSize;
+	int r0 = (area.y - canvas.y) / cellSize;
+	int r1 = (area.br().y - 1 - canvas.y) / cellSize;
+
+	vector<bool> added(rois.size(), false);
+	for (int r = r0; r <= r1; r++) {
+		for (int c = c0; c <= c1; c++) {
+			const vector<int>& cell = cells[r * cols + c];
+			for (int k = 0; k < cell.size(); k++) {
+				int i = cell[k];
+				if (!added[i] && !(rois[i] & area).empty()) {
+					added[i] = true;
+				}
+			}
+		}
+	}
+	for (int i = 0; i < rois.size(); i++)
+		if (added[i])
+			indices.push_back(i);
+}
+
+void RoiIndex::overlaps(vector<pair<int, int>>& pairs, vector<Rect>& overlap_rects) const {
+	for (int i = 0; i < rois.size(); i++) {
+		if (rois[i].empty())
+			continue;
+		vector<int> indices;
+		query(rois[i], indices);
+		for (int k = 0; k < indices.size(); k++) {
+			int j = indices[k];
+			if (j <= i)
+				continue;
+			pairs.push_back(make_pair(i, j));
+			overlap_rects.push_back(rois[i] & rois[j]);
+		}
+	}
+}
+
+Rect RoiIndex::bounds() const {
+	return canvas;
+}
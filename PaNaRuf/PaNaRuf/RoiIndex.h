@@ -0,0 +1,49 @@
+#ifndef  ROI_INDEX_H
+#define  ROI_INDEX_H
+
+#include <iostream>
+#include <opencv2/core.hpp>
+
+using namespace std;
+using namespace cv;
+
+/*
+	Spatial index of the destination image areas (rois) of the warped images.
+	The panorama canvas is divided into square cells, and each cell keeps the indices of the rois
+	covering it, so the images contributing to an area (e.g. an output tile) are found
+	without checking all of the rois.
+*/
+class RoiIndex {
+
+public:
+	int cellSize = 256;
+
+	/*
+		Builds the index of the given rois (the empty rois are skipped).
+	*/
+	void build(const vector<Rect>& rois);
+
+	/*
+		Adds the indices of the rois intersecting "area" to "indices" (in increasing order, without duplicates).
+	*/
+	void query(Rect area, vector<int>& indices) const;
+
+	/*
+		Lists the pairs of rois which intersect (i < j) and their intersections.
+	*/
+	void overlaps(vector<pair<int, int>>& pairs, vector<Rect>& overlap_rects) const;
+
+	/*
+		Returns the union of all rois (the panorama canvas).
+	*/
+	Rect bounds() const;
+
+private:
+	vector<Rect> rois;
+	Rect canvas;
+	int cols = 0;
+	int rows = 0;
+	vector<vector<int>> cells;
+};
+
+#endif
@@ -0,0 +1,119 @@
+#include "Sampler.h"
+
+#if defined(_M_X64) || defined(__x86_64__) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PANARUF_SSE2
+#include <emmintrin.h>
+#endif
+
+Vec3b Sampler::sample(const Mat& image, float x, float y) {
+	Vec3b v;
+	sampleBatch(image, &x, &y, 1, &v[0]);
+	return v;
+}
+
+void Sampler::sampleBatch(const Mat& image, const float* xs, const float* ys, int n, uchar* dst, const ushort* gains) {
+	// the area which can be read, including the mirrored images around the borders.
+	float min_x = -1.0f, max_x = (float)image.cols;
+	float min_y = -1.0f, max_y = (float)image.rows;
+	if (borderMode == BORDER_REFLECT) {
+		min_x = -(float)image.cols;
+		max_x = 2.0f * image.cols;
+		min_y = -(float)image.rows;
+		max_y = 2.0f * image.rows;
+	}
+
+	for (int i = 0; i < n; i++, dst += 3) {
+		// points far outside of the image (or not a number) are black.
+		if (!(xs[i] > min_x && xs[i] < max_x && ys[i] > min_y && ys[i] < max_y)) {
+			dst[0] = dst[1] = dst[2] = 0;
+			continue;
+		}
+
+		// to fixed-point : integer part and INTER_BITS bits of fractional part.
+		int X = cvRound(xs[i] * INTER_TAB_SIZE);
+		int Y = cvRound(ys[i] * INTER_TAB_SIZE);
+		interpolate(image, X >> INTER_BITS, Y >> INTER_BITS, X & (INTER_TAB_SIZE - 1), Y & (INTER_TAB_SIZE - 1), dst);
+		if (gains)
+			applyGain(dst, gains[i]);
+	}
+}
+
+void Sampler::sampleBatchFixed(const Mat& image, const short* xy, const ushort* frac, int n, uchar* dst, const ushort* gains) {
+	for (int i = 0; i < n; i++, dst += 3) {
+		if (xy[2 * i] == INVALID_INDEX) {
+			dst[0] = dst[1] = dst[2] = 0;
+			continue;
+		}
+		interpolate(image, xy[2 * i], xy[2 * i + 1], frac[i] & (INTER_TAB_SIZE - 1), frac[i] >> INTER_BITS, dst);
+		if (gains)
+			applyGain(dst, gains[i]);
+	}
+}
+
+void Sampler::interpolate(const Mat& image, int x, int y, int fx, int fy, uchar* dst) {
+	// fixed-point bilinear weights, their sum is INTER_TAB_SIZE^2.
+	int w00 = (INTER_TAB_SIZE - fx) * (INTER_TAB_SIZE - fy);
+	int w01 = fx * (INTER_TAB_SIZE - fy);
+	int w10 = (INTER_TAB_SIZE - fx) * fy;
+	int w11 = fx * fy;
+	const int shift = 2 * INTER_BITS;
+
+	/*
+		If all of the 4 neighbours are within the image (and 8 bytes can be read from each row),
+		the 3 channels are interpolated at once.
+	*/
+	if (x >= 0 && x < image.cols - 2 && y >= 0 && y < image.rows - 1) {
+		const uchar* p0 = image.ptr<uchar>(y) + 3 * x;
+		const uchar* p1 = image.ptr<uchar>(y + 1) + 3 * x;
+#ifdef PANARUF_SSE2
+		const __m128i z = _mm_setzero_si128();
+		// 16 bit values : b0 g0 r0 b1 g1 r1 . .
+		__m128i r0 = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)p0), z);
+		__m128i r1 = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)p1), z);
+		// pairs of the left and right neighbours : b0 b1 g0 g1 r0 r1 . .
+		r0 = _mm_unpacklo_epi16(r0, _mm_srli_si128(r0, 6));
+		r1 = _mm_unpacklo_epi16(r1, _mm_srli_si128(r1, 6));
+		// weighted sums of the pairs : b g r .
+		__m128i sum = _mm_add_epi32(_mm_madd_epi16(r0, _mm_set1_epi32((w01 << 16) | w00)),
+			_mm_madd_epi16(r1, _mm_set1_epi32((w11 << 16) | w10)));
+		sum = _mm_srai_epi32(_mm_add_epi32(sum, _mm_set1_epi32(1 << (shift - 1))), shift);
+		sum = _mm_packs_epi32(sum, sum);
+		sum = _mm_packus_epi16(sum, sum);
+		int bgr = _mm_cvtsi128_si32(sum);
+		dst[0] = (uchar)bgr;
+		dst[1] = (uchar)(bgr >> 8);
+		dst[2] = (uchar)(bgr >> 16);
+#else
+		for (int c = 0; c < 3; c++)
+			dst[c] = (uchar)((p0[c] * w00 + p0[c + 3] * w01 + p1[c] * w10 + p1[c + 3] * w11 + (1 << (shift - 1))) >> shift);
+#endif
+		return;
+	}
+
+	/*
+		At the borders of the image, the neighbours outside of the image are black or mirrored.
+	*/
+	int weights[4] = { w00, w01, w10, w11 };
+	int sum[3] = { 0, 0, 0 };
+	for (int k = 0; k < 4; k++) {
+		int xx = borderIndex(x + (k & 1), image.cols);
+		int yy = borderIndex(y + (k >> 1), image.rows);
+		if (weights[k] == 0 || xx < 0 || yy < 0)
+			continue;
+		const uchar* p = image.ptr<uchar>(yy) + 3 * xx;
+		for (int c = 0; c < 3; c++)
+			sum[c] += p[c] * weights[k];
+	}
+	for (int c = 0; c < 3; c++)
+		dst[c] = (uchar)((sum[c] + (1 << (shift - 1))) >> shift);
+}
+
+int Sampler::borderIndex(int i, int n) {
+	if (borderMode == BORDER_REFLECT) {
+		if (i < 0)
+			i = -i - 1;
+		else if (i >= n)
+			i = 2 * n - i - 1;
+	}
+	return (i >= 0 && i < n) ? i : -1;
+}
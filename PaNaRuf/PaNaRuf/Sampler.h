@@ -0,0 +1,84 @@
+#ifndef  SAMPLER_H
+#define  SAMPLER_H
+
+#include <iostream>
+#include <climits>
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+
+using namespace std;
+using namespace cv;
+
+/*
+	This class reads pixel values of a 3-channel (CV_8UC3) image at non-integer positions
+	using bilinear interpolation.
+
+	* The bilinear weights are fixed-point numbers (INTER_BITS fractional bits, as in OpenCV's remap),
+	  so an integer position simply gets the weight 1 for its own pixel: no special case, no division.
+	* All three channels of a pixel are interpolated at once with SSE.
+	* The points outside of the image get black color (BORDER_CONSTANT), or, with BORDER_REFLECT,
+	  the image is virtually mirrored once around each border (fedcba|abcdef|fedcba) without
+	  creating the mirrored images.
+	* The batch functions sample n points at a time and write them to a row of a destination image.
+	  They can also multiply each interpolated value by a gain (exposure compensation), in the same pass.
+*/
+class Sampler {
+
+public:
+	static const int INTER_BITS = 5;
+	static const int INTER_TAB_SIZE = 1 << INTER_BITS;
+
+	/*
+		Integer coordinate of the fixed-point maps given to the points without a source pixel, they are black.
+		(a mirrored position can not be told apart from an invalid one after the int16 saturation,
+		so the invalid points are marked with this value instead of a far coordinate)
+	*/
+	static const short INVALID_INDEX = SHRT_MIN;
+
+	// BORDER_CONSTANT (black) or BORDER_REFLECT
+	int borderMode = BORDER_CONSTANT;
+
+	/*
+		Returns the pixel value at (x, y).
+	*/
+	Vec3b sample(const Mat& image, float x, float y);
+
+	static const int GAIN_BITS = 8;
+
+	/*
+		Samples the points (xs[i], ys[i]), i = 0 ... n-1, and writes the pixel values to dst (3 * n bytes).
+		* gains -> if it is given, the value of point i is multiplied by gains[i] / 2^GAIN_BITS.
+	*/
+	void sampleBatch(const Mat& image, const float* xs, const float* ys, int n, uchar* dst, const ushort* gains = 0);
+
+	/*
+		Samples n points given in fixed-point format (as in WarpMap):
+		* xy -> integer coordinates (x0, y0, x1, y1, ...)
+		* frac -> index of the fractional part (fy * INTER_TAB_SIZE + fx)
+		and writes the pixel values to dst (3 * n bytes). The points at INVALID_INDEX are black.
+		* gains -> as in sampleBatch.
+	*/
+	void sampleBatchFixed(const Mat& image, const short* xy, const ushort* frac, int n, uchar* dst, const ushort* gains = 0);
+
+private:
+	/*
+		Returns the index of the pixel read for index i (in a row/column of n pixels) with respect to the border mode.
+		Returns -1 if the pixel is black.
+	*/
+	int borderIndex(int i, int n);
+
+	/*
+		Multiplies the 3 values of a pixel by gain / 2^GAIN_BITS.
+	*/
+	inline void applyGain(uchar* dst, int gain) {
+		for (int c = 0; c < 3; c++)
+			dst[c] = saturate_cast<uchar>((dst[c] * gain + (1 << (GAIN_BITS - 1))) >> GAIN_BITS);
+	}
+
+	/*
+		Interpolates the pixel at integer position (x, y) and fractional position (fx, fy) / INTER_TAB_SIZE.
+	*/
+	void interpolate(const Mat& image, int x, int y, int fx, int fy, uchar* dst);
+};
+
+#endif
@@ -0,0 +1,12 @@
+#ifndef  SEAM_FINDER_TYPE_H  
+#define  SEAM_FINDER_TYPE_H 
+
+/*
+	Algorithm used to find the seams among the warped images before blending.
+	* VORONOI_SEAM -> fastest, the seams only depend on the overlaps of the masks (not on the image content).
+	* DP_SEAM -> dynamic programming on the color gradient, a good balance of speed and quality.
+	* GRAPH_CUT_SEAM -> min-cut on the color differences, the best seams but the slowest.
+*/
+enum SeamFinderType { VORONOI_SEAM, DP_SEAM, GRAPH_CUT_SEAM };
+
+#endif 
@@ -0,0 +1,20 @@
+#include "TileScheduler.h"
+
+void TileScheduler::getTiles(Size size, vector<Rect>& tiles) {
+	for (int y = 0; y < size.height; y += tileSize) {
+		for (int x = 0; x < size.width; x += tileSize) {
+			tiles.push_back(Rect(x, y, min(tileSize, size.width - x), min(tileSize, size.height - y)));
+		}
+	}
+}
+
+void TileScheduler::run(Size size, const function<void(const Rect&)>& work) {
+	vector<Rect> tiles;
+	getTiles(size, tiles);
+
+	// Tiles at the borders of the image are smaller, so they are given to the threads dynamically.
+#pragma omp parallel for schedule(dynamic)
+	for (int i = 0; i < (int)tiles.size(); i++) {
+		work(tiles[i]);
+	}
+}
@@ -0,0 +1,35 @@
+#ifndef  TILE_SCHEDULER_H
+#define  TILE_SCHEDULER_H
+
+#include <iostream>
+#include <functional>
+#include <omp.h>
+#include <opencv2/core.hpp>
+
+using namespace std;
+using namespace cv;
+
+/*
+	This class splits a destination image into square tiles (64x64 by default)
+	and processes them in parallel.
+	The tiles are ordered row by row (row-major), and each tile is processed row by row,
+	so the writes to the row-major cv::Mat images stay in the cache.
+*/
+class TileScheduler {
+
+public:
+	int tileSize = 64;
+
+	/*
+		Adds the tiles covering an image of the given size to "tiles" in row-major order.
+	*/
+	void getTiles(Size size, vector<Rect>& tiles);
+
+	/*
+		Calls "work" for each tile of an image of the given size.
+		The tiles are distributed among the threads.
+	*/
+	void run(Size size, const function<void(const Rect&)>& work);
+};
+
+#endif
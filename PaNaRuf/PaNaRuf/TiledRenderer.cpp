@@ -0,0 +1,135 @@
+#include "TiledRenderer.h"
+
+bool TiledRenderer::render(PanoramaType type, const vector<Size>& sourceSizes, const vector<Mat>& Ks, const vector<Mat>& Rs,
+	const vector<Mat>& gainMaps, const function<Mat(int)>& loadImage, OutputWriter& writer) {
+	// The float maps are needed for the feathering weights, and the tile maps are never re-used.
+	warpMapper.useFixedPoint = false;
+
+	// Forward warping of all images gives the area of each image in the panorama.
+	vector<Rect> rois(sourceSizes.size());
+	for (int i = 0; i < sourceSizes.size(); i++) {
+		try {
+			rois[i] = warpMapper.findRoi(type, sourceSizes[i], type == PERSPECTIVE ? Mat() : Ks[i], Rs[i]);
+		}
+		catch (Exception e) {
+			rois[i] = Rect();
+		}
+	}
+	roiIndex.build(rois);
+
+	Rect canvas = roiIndex.bounds();
+	if (canvas.empty() || !writer.open(canvas.size()))
+		return false;
+
+	vector<Rect> tiles;
+	vector<int> band_candidates, loading, kept;
+	vector<Mat> images(sourceSizes.size());
+	vector<uchar> loaded(sourceSizes.size(), 0); // an image which can not be loaded is not tried again in each band.
+	for (int band_y = canvas.y; band_y < canvas.br().y; band_y += tileSize) {
+		int band_height = min(tileSize, canvas.br().y - band_y);
+		Mat band(band_height, canvas.width, CV_8UC3);
+
+		// only the images covering the band are needed, the ones kept from the previous bands are not loaded again.
+		band_candidates.clear();
+		roiIndex.query(Rect(canvas.x, band_y, canvas.width, band_height), band_candidates);
+		loading.clear();
+		for (int k = 0; k < band_candidates.size(); k++) {
+			if (!loaded[band_candidates[k]])
+				loading.push_back(band_candidates[k]);
+		}
+#pragma omp parallel for schedule(dynamic)
+		for (int k = 0; k < (int)loading.size(); k++) {
+			images[loading[k]] = loadImage(loading[k]);
+			loaded[loading[k]] = 1;
+		}
+
+		tiles.clear();
+		for (int x = canvas.x; x < canvas.br().x; x += tileSize)
+			tiles.push_back(Rect(x, band_y, min(tileSize, canvas.br().x - x), band_height));
+
+#pragma omp parallel for schedule(dynamic)
+		for (int t = 0; t < (int)tiles.size(); t++) {
+			Rect tile = tiles[t];
+			renderTile(type, images, Ks, Rs, gainMaps, rois, tile, band(Rect(tile.x - canvas.x, 0, tile.width, tile.height)));
+		}
+
+		writer.writeRows(band);
+
+		/*
+			The images which end within the band are not needed anymore. The others also cover the next band,
+			they are kept while they fit in the cache, the ones which cover the most bands first.
+		*/
+		int next_y = band_y + band_height;
+		kept.clear();
+		for (int k = 0; k < band_candidates.size(); k++) {
+			int i = band_candidates[k];
+			if (rois[i].br().y > next_y && !images[i].empty())
+				kept.push_back(i);
+			else
+				images[i].release();
+		}
+		sort(kept.begin(), kept.end(), [&](int a, int b) { return rois[a].br().y > rois[b].br().y; });
+		size_t kept_bytes = 0;
+		for (int k = 0; k < kept.size(); k++) {
+			int i = kept[k];
+			size_t bytes = images[i].total() * images[i].elemSize();
+			if (kept_bytes + bytes <= cacheLimitBytes)
+				kept_bytes += bytes;
+			else {
+				images[i].release();
+				loaded[i] = 0;
+			}
+		}
+		cout << "Rendered rows " << band_y - canvas.y + band_height << "/" << canvas.height << endl;
+	}
+
+	writer.close();
+	return writer.good();
+}
+
+void TiledRenderer::renderTile(PanoramaType type, const vector<Mat>& images, const vector<Mat>& Ks, const vector<Mat>& Rs,
+	const vector<Mat>& gainMaps, const vector<Rect>& rois, Rect tile, Mat result) {
+
+	// weighted sum of the samples and sum of the weights of each pixel of the tile.
+	Mat sum = Mat::zeros(tile.size(), CV_32FC3);
+	Mat weight_sum = Mat::zeros(tile.size(), CV_32F);
+
+	vector<int> candidates;
+	roiIndex.query(tile, candidates);
+
+	for (int k = 0; k < candidates.size(); k++) {
+		int i = candidates[k];
+		if (images[i].empty())
+			continue;
+		Rect area = tile & rois[i];
+
+		/*
+			The map of only the part of the image within the tile is computed.
+			(the maps are computed relative to the top-left corner of the roi, so a part of it gives the same coordinates)
+		*/
+		WarpMap warpMap;
+		if (type == PERSPECTIVE)
+			warpMapper.buildPerspectiveMap(images[i].size(), area, Rs[i], warpMap);
+		else
+			warpMapper.buildMap(type, images[i].size(), area, Ks[i], Rs[i], warpMap);
+
+		/*
+			The samples are feather-blended into the tile while they are read (no warped image).
+			The gain map covers the whole roi of the image, so the gains of the tile part are taken from it.
+		*/
+		Mat gains = i < gainMaps.size() ? gainMaps[i] : Mat();
+		warpMapper.composite(images[i], warpMap, sum, weight_sum, area.tl() - tile.tl(), gains, rois[i]);
+	}
+
+	for (int y = 0; y < tile.height; y++) {
+		const float* src = sum.ptr<float>(y);
+		const float* w = weight_sum.ptr<float>(y);
+		uchar* dst = result.ptr<uchar>(y);
+		for (int x = 0; x < tile.width; x++) {
+			// the pixels not covered by any image are black.
+			float inv = w[x] > 0.0f ? 1.0f / w[x] : 0.0f;
+			for (int c = 0; c < 3; c++)
+				dst[3 * x + c] = saturate_cast<uchar>(src[3 * x + c] * inv);
+		}
+	}
+}
@@ -0,0 +1,72 @@
+#ifndef  TILED_RENDERER_H
+#define  TILED_RENDERER_H
+
+#include <iostream>
+#include <functional>
+#include <algorithm>
+#include <omp.h>
+#include <opencv2/core.hpp>
+#include "PanoramaType.h"
+#include "WarpMapper.h"
+#include "RoiIndex.h"
+#include "OutputWriter.h"
+
+using namespace std;
+using namespace cv;
+
+/*
+	Renders a panorama which is too large to be kept in memory (gigapixel panoramas),
+	or quickly composites a panorama in memory (feather mode, with a MatWriter).
+
+	Instead of warping the whole images and blending the full panorama, the panorama is divided into
+	square tiles. For each tile, only the images covering it are found (RoiIndex), the map of the
+	tile's part of each image is computed and the image is sampled with it, and the samples are
+	blended with feathering: each sample is weighted by its distance to the border of its source image.
+	Each tile is owned by one thread, so its float sums need no atomics, and they are normalized once
+	all of the images of the tile are added.
+	The tiles of a band (a row of tiles) are rendered in parallel, then the band is given to the writer
+	and freed, so the memory use depends on the width of the panorama and not on its area.
+	An image is loaded (by the caller) for the first band which it covers and kept for its next bands while the
+	kept images fit in "cacheLimitBytes", so most images are decoded once.
+	Memory bound: all of the images covering a band are in memory together (an image is always loaded whole,
+	the decoders can not read a part of it), with the band itself (3 * panorama width * tileSize bytes) and the
+	float sums of one tile per thread. Between two bands, at most "cacheLimitBytes" of images are kept.
+*/
+class TiledRenderer {
+
+public:
+	// Width and height of a tile (and height of a band).
+	int tileSize = 512;
+
+	// Maximum size of the loaded images kept for the next bands.
+	size_t cacheLimitBytes = size_t(1) << 30;
+
+	/*
+		Renders the panorama of the given images and writes it to "writer" band by band.
+		* sourceSizes -> sizes of the images which "loadImage" gives.
+		* loadImage(i) -> returns image i, it is called from several threads. An image which can not be loaded
+		  (empty Mat) is left out of the band.
+		* For PERSPECTIVE, Ks are not used and Rs are the homography matrices of the images.
+		* gainMaps -> exposure gain map of each image (see GainCompensator), an empty one (or an empty vector)
+		  leaves the image unchanged.
+		Returns false if the output can not be created or written, or none of the images is visible.
+	*/
+	bool render(PanoramaType type, const vector<Size>& sourceSizes, const vector<Mat>& Ks, const vector<Mat>& Rs,
+		const vector<Mat>& gainMaps, const function<Mat(int)>& loadImage, OutputWriter& writer);
+
+private:
+	// Computes the maps of the tile parts and samples the images.
+	WarpMapper warpMapper;
+
+	// Finds the images covering a tile.
+	RoiIndex roiIndex;
+
+	/*
+		Renders the panorama area "tile" (in panorama coordinates) to "result" (CV_8UC3).
+		"images" has the loaded images of the band (the others are empty).
+	*/
+	void renderTile(PanoramaType type, const vector<Mat>& images, const vector<Mat>& Ks, const vector<Mat>& Rs,
+		const vector<Mat>& gainMaps, const vector<Rect>& rois, Rect tile, Mat result);
+};
+
+#endif
@@ -7,86 +7,70 @@ using namespace detail;
 int Utils::addInputImages(vector<String> image_names, vector<Mat>& images) {
 	double work_scale = 1;
 	bool is_work_scale_set = false;
+	originalSizes.assign(image_names.size(), Size());
+	imageStore.open(image_names);
+
+	/*
+		The work scale is found from the header of the first image, so the loader can decode
+		the images directly at a reduced size (1/2, 1/4 or 1/8) before the final resize.
+	*/
+	Size first_size = image_names.empty() ? Size() : ImageLoader::readImageSize(image_names[0]);
+	if (first_size.area() > 0) {
+		work_scale = min(1.0, sqrt(0.6 * 1e6 / first_size.area()));
+		is_work_scale_set = true;
+	}
+
+	ImageLoader loader;
+	loader.scale = work_scale;
+	loader.start(image_names);
 	for (int i = 0; i < image_names.size(); i++) {
-		Mat image = imread(image_names[i]);
+		Mat image = loader.get(i);
 		if (image.empty()) {
 			return i;
 		}
 
+		Size original_size = loader.getOriginalSize(i);
+		originalSizes[i] = original_size;
 		if (!is_work_scale_set)
 		{
-			work_scale = min(1.0, sqrt(0.6 * 1e6 / image.size().area()));
+			work_scale = min(1.0, sqrt(0.6 * 1e6 / original_size.area()));
 			is_work_scale_set = true;
 		}
 
-		resize(image, images[i], Size(), work_scale, work_scale, INTER_LINEAR_EXACT);
+		Size work_size(max(1, cvRound(original_size.width * work_scale)), max(1, cvRound(original_size.height * work_scale)));
+		resize(image, images[i], work_size, 0, 0, INTER_LINEAR_EXACT);
 		image.release();
 
 	}
+	workScale = work_scale;
+	composeScale = work_scale;
 	return -1;
 }
 
-
-void Utils::addReflectiveImagesAround(Mat image_warped, Mat& middle) {
-
-	Mat  mirror_top, mirror_bottom;
-	Mat left, right;
-
-	//MIDDLE
-	image_warped.copyTo(middle);
-	flip(middle, mirror_top, 0);
-	flip(middle, mirror_bottom, -1);
-	flip(mirror_bottom, mirror_bottom, 1);
-	vconcat(mirror_top, middle, middle);
-	vconcat(middle, mirror_bottom, middle);
-
-	//LEFT
-	flip(image_warped, left, 1);
-
-	flip(left, mirror_top, 0);
-	flip(left, mirror_bottom, -1);
-	flip(mirror_bottom, mirror_bottom, 1);
-	vconcat(mirror_top, left, left);
-	vconcat(left, mirror_bottom, left);
-
-	//RIGHT
-	flip(image_warped, right, 1);
-
-	flip(right, mirror_top, 0);
-	flip(right, mirror_bottom, -1);
-	flip(mirror_bottom, mirror_bottom, 1);
-	vconcat(mirror_top, right, right);
-	vconcat(right, mirror_bottom, right);
-
-	//All
-	hconcat(left, middle, middle);
-	hconcat(middle, right, middle);
-
-	left.release();
-	right.release();
-	mirror_bottom.release();
-	mirror_top.release();
-
+void Utils::setComposeScale(double compose_megapix) {
+	double scale = 1;
+	if (compose_megapix >= 0 && !originalSizes.empty() && originalSizes[0].area() > 0)
+		scale = min(1.0, sqrt(compose_megapix * 1e6 / originalSizes[0].area()));
+	composeScale = max(scale, workScale);
 }
 
-Vec3b Utils::BilinearInterpolation(double new_x, double new_y, Mat img2) {
-	Vec3b v;
-	double intensity_left_right;
-	double intensity_left_down;
-	double intensity_result;
-	for (int i = 0; i < 3; i++) {
-		intensity_left_right = ((ceil(new_x) - new_x) / (ceil(new_x) - floor(new_x))) * img2.at<Vec3b>((int)floor(new_y), (int)floor(new_x))[i]
-			+ ((new_x - floor(new_x)) / (ceil(new_x) - floor(new_x))) * img2.at<Vec3b>((int)floor(new_y), (int)ceil(new_x))[i];
-
-		intensity_left_down = ((ceil(new_x) - new_x) / (ceil(new_x) - floor(new_x))) * img2.at<Vec3b>((int)ceil(new_y), (int)floor(new_x))[i]
-			+ ((new_x - floor(new_x)) / (ceil(new_x) - floor(new_x))) * img2.at<Vec3b>((int)ceil(new_y), (int)ceil(new_x))[i];
-
-		intensity_result = ((ceil(new_y) - new_y) / (ceil(new_y) - floor(new_y))) * intensity_left_right
-			+ ((new_y - floor(new_y)) / (ceil(new_y) - floor(new_y))) * intensity_left_down;
-
-		v[i] = (int)intensity_result;
+Size Utils::getComposeSize(int i) {
+	return Size(max(1, cvRound(originalSizes[i].width * composeScale)), max(1, cvRound(originalSizes[i].height * composeScale)));
+}
 
-	}
+Mat Utils::toComposeSize(const Mat& image, int i) {
+	Size size = getComposeSize(i);
+	if (image.size() == size)
+		return image;
+	Mat resized;
+	resize(image, resized, size, 0, 0, image.cols > size.width ? INTER_AREA : INTER_LINEAR_EXACT);
+	return resized;
+}
 
-	return v;
+Mat Utils::loadComposeImage(int i) {
+	Size original_size;
+	Mat image = imageStore.get(i, composeScale, original_size);
+	if (image.empty() || original_size != originalSizes[i])
+		return Mat();
+	return toComposeSize(image, i);
 }
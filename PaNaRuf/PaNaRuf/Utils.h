@@ -5,6 +5,8 @@
 #include <opencv2/core.hpp>
 #include <opencv2/imgproc/imgproc.hpp>
 #include "opencv2/highgui.hpp"
+#include "ImageLoader.h"
+#include "ImageStore.h"
 #ifdef HAVE_OPENCV_XFEATURES2D
 
 using namespace std;
@@ -17,6 +19,7 @@ public:
 	/*
 		We add all of the images to "images" vector by reading image names from the vector "image_names".
 		Additionally, we decrease the size of the image in order to improve the overall complexity.
+		The images are read and decoded in the background (ImageLoader) while the previous ones are resized.
 		
 		* If all read operations are done without any trouble, then the function returns -1.
 		* Else it returns the index of the image making problem. (we need this information to
@@ -24,17 +27,45 @@ public:
 	*/
 	int addInputImages(vector<String> image_names, vector<Mat>& images);
 
-	/*	This function creates self-reflected images around the current image.
-		We are doing this to get rid of black colors around the warped images
-		which is important for applying multi-band blending to all warped images in the end.
+	/*
+		The images are registered at "workScale" (about 0.6 megapixels), and the panorama is composed (warped and blended)
+		at "composeScale", both relative to the original images.
+		* compose_megapix -> megapixels of the first image at the compose scale, 0 for the work scale, negative for the original resolution.
+		  The compose scale is never below the work scale.
+		It must be called after addInputImages.
+	*/
+	void setComposeScale(double compose_megapix);
+
+	/*
+		Returns image i (original index in the names given to addInputImages) at the compose scale.
+		The image is decoded again from "imageStore" (at a reduced size if possible), so the pixels are only in memory
+		while the image is warped (or kept in the store's cache), and the work images can be released after the registration.
+		Returns an empty Mat if the file can not be read anymore (or it is not the same image).
 	*/
-	void addReflectiveImagesAround(Mat image_sri, Mat& original_image);
+	Mat loadComposeImage(int i);
+
+	/*
+		Size of image i at the compose scale.
+	*/
+	Size getComposeSize(int i);
+
+	// Scale of the images given by addInputImages.
+	double workScale = 1;
+
+	// Scale of the warped images and of the panorama.
+	double composeScale = 1;
+
+	// Sizes of the input images in the files.
+	vector<Size> originalSizes;
+
+	// File references (and compressed bytes) of the input images, decodes them on demand.
+	ImageStore imageStore;
 
+private:
 	/*
-		The function below takes (x,y) image coordinates and calculates the pixel value
-		using bilinear interpolation method.
+		Resizes an image decoded for the compose scale to its exact compose size.
 	*/
-	Vec3b BilinearInterpolation(double x, double y, Mat img);
+	Mat toComposeSize(const Mat& image, int i);
 };
 #endif
 #endif 
\ No newline at end of file
@@ -0,0 +1,130 @@
+#ifndef  WARP_ENGINE_H
+#define  WARP_ENGINE_H
+
+#include <iostream>
+#include <type_traits>
+#include <omp.h>
+#include <opencv2/core.hpp>
+#include "WarpMap.h"
+#include "WarpKernels.h"
+#include "TileScheduler.h"
+#include "Projections.h"
+
+using namespace std;
+using namespace cv;
+
+/*
+	Warping engine for the panoramas made of cameras (K, R) and a projection policy (see Projections.h).
+	The functions of the policy are inlined at compile time, so each projection gets its own
+	map builder without any virtual call per pixel:
+	* separable projections -> the column and row functions are computed once per column / row
+	  and the vectorized row kernels (WarpKernels) do the per-pixel work.
+	* the other projections -> the ray of each pixel is computed by the inlined "unproject" of the policy.
+
+	The source point of a ray is K * R * ray.
+	The destination area of an image is found by WarpMapper::findRoi from the border of the image with the
+	forward mapping ("project") of the policy.
+*/
+template<class Projection>
+class WarpEngine {
+
+public:
+	/*
+		Computes the source image coordinates of the destination image area "roi".
+		The maps and the mask of "warpMap" must be allocated before.
+	*/
+	static void buildMap(Rect roi, Mat K, Mat R, const SourceWindow& window, WarpKernels& kernels, TileScheduler& scheduler, WarpMap& warpMap) {
+		int wd = roi.br().x - roi.tl().x; // width of destination image.
+		int hd = roi.br().y - roi.tl().y; // height of destination image.
+
+		// offset is used to shift the destination image point to actual point in x-y image coordinates.
+		Point2d offset = 0.5 * Point2d((roi.tl() + roi.br())) - Point2d(double(wd) * 0.5, double(hd) * 0.5);
+
+		Mat KR = K * R;
+		double fx = K.at<double>(0, 0);
+		double fy = K.at<double>(1, 1);
+
+		// normalized x of each column.
+		vector<float> xs(wd);
+		for (int x = 0; x < wd; x++) {
+			xs[x] = (float)((x + offset.x) / fx);
+		}
+
+		buildRows(xs, offset.y, fy, KR, window, kernels, scheduler, warpMap, integral_constant<bool, Projection::separable>());
+	}
+
+private:
+	/*
+		Separable projection : (u, v, w) = KR * (s(x) * a(y), b(y), c(x) * a(y)) = P * s + Q * c + T for each row.
+	*/
+	static void buildRows(const vector<float>& xs, double offset_y, double fy, Mat KR, const SourceWindow& window,
+		WarpKernels& kernels, TileScheduler& scheduler, WarpMap& warpMap, true_type) {
+		int wd = (int)xs.size();
+
+		// s(x) and c(x) only depend on the column, they are computed once for each column.
+		vector<float> s(wd), c(wd);
+		Projection::columns(xs.data(), s.data(), c.data(), wd);
+
+		// The destination image is processed tile by tile, each tile row by row.
+		scheduler.run(warpMap.roi.size(), [&](const Rect& tile) {
+			for (int y = tile.y; y < tile.y + tile.height; y++) {
+				double a, b;
+				Projection::row((y + offset_y) / fy, a, b);
+
+				RowProjection projection;
+				for (int i = 0; i < 3; i++) {
+					projection.P[i] = (float)(KR.at<double>(i, 0) * a);
+					projection.Q[i] = (float)(KR.at<double>(i, 2) * a);
+					projection.T[i] = (float)(KR.at<double>(i, 1) * b);
+				}
+				projection.checkBehindCamera = true;
+
+				kernels.projectRow(projection, window, s.data() + tile.x, c.data() + tile.x, tile.width,
+					warpMap.map_x.ptr<float>(y) + tile.x, warpMap.map_y.ptr<float>(y) + tile.x, warpMap.mask.ptr<uchar>(y) + tile.x);
+			}
+		});
+	}
+
+	/*
+		Non-separable projection : the ray of each pixel is given by the policy.
+	*/
+	static void buildRows(const vector<float>& xs, double offset_y, double fy, Mat KR, const SourceWindow& window,
+		WarpKernels& kernels, TileScheduler& scheduler, WarpMap& warpMap, false_type) {
+		float M[9];
+		for (int i = 0; i < 9; i++)
+			M[i] = (float)KR.at<double>(i / 3, i % 3);
+
+		scheduler.run(warpMap.roi.size(), [&](const Rect& tile) {
+			for (int y = tile.y; y < tile.y + tile.height; y++) {
+				float yn = (float)((y + offset_y) / fy);
+				float* map_x = warpMap.map_x.ptr<float>(y) + tile.x;
+				float* map_y = warpMap.map_y.ptr<float>(y) + tile.x;
+				uchar* mask = warpMap.mask.ptr<uchar>(y) + tile.x;
+
+				for (int k = 0; k < tile.width; k++) {
+					float X, Y, Z;
+					bool valid = Projection::unproject(xs[tile.x + k], yn, X, Y, Z);
+					float u = M[0] * X + M[1] * Y + M[2] * Z;
+					float v = M[3] * X + M[4] * Y + M[5] * Z;
+					float w = M[6] * X + M[7] * Y + M[8] * Z;
+
+					// no ray, or the ray is behind the camera.
+					if (!valid || w <= 0) {
+						map_x[k] = WarpKernels::INVALID_COORDINATE;
+						map_y[k] = WarpKernels::INVALID_COORDINATE;
+						mask[k] = 0;
+						continue;
+					}
+
+					float px = u / w + window.shift_x;
+					float py = v / w + window.shift_y;
+					map_x[k] = px;
+					map_y[k] = py;
+					mask[k] = (px > window.min_x && px < window.max_x && py > window.min_y && py < window.max_y) ? 255 : 0;
+				}
+			}
+		});
+	}
+};
+
+#endif
@@ -0,0 +1,291 @@
+#include "WarpKernels.h"
+
+#if defined(_M_X64) || defined(__x86_64__) || defined(_M_IX86) || defined(__i386__)
+#define PANARUF_X86
+#include <immintrin.h>
+#endif
+
+/*
+	AVX2 functions are compiled for AVX2 even if the rest of the program is not,
+	and they are called only if the CPU supports AVX2.
+*/
+#if defined(__GNUC__) || defined(__clang__)
+#define PANARUF_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define PANARUF_TARGET_AVX2
+#endif
+
+const float WarpKernels::INVALID_COORDINATE = -1.0e6f;
+
+/*
+	Plain version of the kernel. It is used for the remaining pixels of a row
+	(and for all pixels if the CPU has no SSE).
+*/
+static void projectRowScalar(const RowProjection& p, const SourceWindow& win,
+	const float* s, const float* c, int x, int n, float* map_x, float* map_y, uchar* mask) {
+
+	for (; x < n; x++) {
+		float u = p.P[0] * s[x] + p.Q[0] * c[x] + p.T[0];
+		float v = p.P[1] * s[x] + p.Q[1] * c[x] + p.T[1];
+		float w = p.P[2] * s[x] + p.Q[2] * c[x] + p.T[2];
+
+		// If the point is beyond camera, do not take it.
+		if (p.checkBehindCamera && w <= 0) {
+			map_x[x] = WarpKernels::INVALID_COORDINATE;
+			map_y[x] = WarpKernels::INVALID_COORDINATE;
+			mask[x] = 0;
+			continue;
+		}
+
+		float px = u / w + win.shift_x;
+		float py = v / w + win.shift_y;
+		map_x[x] = px;
+		map_y[x] = py;
+		mask[x] = (px > win.min_x && px < win.max_x && py > win.min_y && py < win.max_y) ? 255 : 0;
+	}
+}
+
+/*
+	Plain version of the linear kernel: the ray is stepped by P at each pixel.
+*/
+static void projectRowLinearScalar(const RowProjection& p, const SourceWindow& win,
+	float x0, int x, int n, float* map_x, float* map_y, uchar* mask) {
+
+	float u = p.P[0] * (x0 + x) + p.T[0];
+	float v = p.P[1] * (x0 + x) + p.T[1];
+	float w = p.P[2] * (x0 + x) + p.T[2];
+
+	for (; x < n; x++, u += p.P[0], v += p.P[1], w += p.P[2]) {
+		// If the point is beyond camera, do not take it.
+		if (p.checkBehindCamera && w <= 0) {
+			map_x[x] = WarpKernels::INVALID_COORDINATE;
+			map_y[x] = WarpKernels::INVALID_COORDINATE;
+			mask[x] = 0;
+			continue;
+		}
+
+		float px = u / w + win.shift_x;
+		float py = v / w + win.shift_y;
+		map_x[x] = px;
+		map_y[x] = py;
+		mask[x] = (px > win.min_x && px < win.max_x && py > win.min_y && py < win.max_y) ? 255 : 0;
+	}
+}
+
+#ifdef PANARUF_X86
+
+/*
+	SSE version: two groups of 4 pixels are processed at each step.
+*/
+static int projectRowSSE(const RowProjection& p, const SourceWindow& win,
+	const float* s, const float* c, int n, float* map_x, float* map_y, uchar* mask) {
+
+	const __m128 P0 = _mm_set1_ps(p.P[0]), P1 = _mm_set1_ps(p.P[1]), P2 = _mm_set1_ps(p.P[2]);
+	const __m128 Q0 = _mm_set1_ps(p.Q[0]), Q1 = _mm_set1_ps(p.Q[1]), Q2 = _mm_set1_ps(p.Q[2]);
+	const __m128 T0 = _mm_set1_ps(p.T[0]), T1 = _mm_set1_ps(p.T[1]), T2 = _mm_set1_ps(p.T[2]);
+	const __m128 shift_x = _mm_set1_ps(win.shift_x), shift_y = _mm_set1_ps(win.shift_y);
+	const __m128 min_x = _mm_set1_ps(win.min_x), max_x = _mm_set1_ps(win.max_x);
+	const __m128 min_y = _mm_set1_ps(win.min_y), max_y = _mm_set1_ps(win.max_y);
+	const __m128 invalid = _mm_set1_ps(WarpKernels::INVALID_COORDINATE);
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 all = _mm_castsi128_ps(_mm_set1_epi32(-1));
+
+	int x = 0;
+	for (; x <= n - 8; x += 8) {
+		int bits = 0;
+		for (int k = 0; k < 8; k += 4) {
+			__m128 sv = _mm_loadu_ps(s + x + k);
+			__m128 cv = _mm_loadu_ps(c + x + k);
+			__m128 u = _mm_add_ps(_mm_add_ps(_mm_mul_ps(P0, sv), _mm_mul_ps(Q0, cv)), T0);
+			__m128 v = _mm_add_ps(_mm_add_ps(_mm_mul_ps(P1, sv), _mm_mul_ps(Q1, cv)), T1);
+			__m128 w = _mm_add_ps(_mm_add_ps(_mm_mul_ps(P2, sv), _mm_mul_ps(Q2, cv)), T2);
+
+			__m128 valid = p.checkBehindCamera ? _mm_cmpgt_ps(w, zero) : all;
+			__m128 px = _mm_add_ps(_mm_div_ps(u, w), shift_x);
+			__m128 py = _mm_add_ps(_mm_div_ps(v, w), shift_y);
+
+			__m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpgt_ps(px, min_x), _mm_cmplt_ps(px, max_x)),
+				_mm_and_ps(_mm_cmpgt_ps(py, min_y), _mm_cmplt_ps(py, max_y)));
+			inside = _mm_and_ps(inside, valid);
+
+			px = _mm_or_ps(_mm_and_ps(valid, px), _mm_andnot_ps(valid, invalid));
+			py = _mm_or_ps(_mm_and_ps(valid, py), _mm_andnot_ps(valid, invalid));
+			_mm_storeu_ps(map_x + x + k, px);
+			_mm_storeu_ps(map_y + x + k, py);
+			bits |= _mm_movemask_ps(inside) << k;
+		}
+		for (int k = 0; k < 8; k++)
+			mask[x + k] = ((bits >> k) & 1) ? 255 : 0;
+	}
+	return x;
+}
+
+/*
+	AVX2 version: 8 pixels are processed at each step.
+*/
+PANARUF_TARGET_AVX2
+static int projectRowAVX2(const RowProjection& p, const SourceWindow& win,
+	const float* s, const float* c, int n, float* map_x, float* map_y, uchar* mask) {
+
+	const __m256 P0 = _mm256_set1_ps(p.P[0]), P1 = _mm256_set1_ps(p.P[1]), P2 = _mm256_set1_ps(p.P[2]);
+	const __m256 Q0 = _mm256_set1_ps(p.Q[0]), Q1 = _mm256_set1_ps(p.Q[1]), Q2 = _mm256_set1_ps(p.Q[2]);
+	const __m256 T0 = _mm256_set1_ps(p.T[0]), T1 = _mm256_set1_ps(p.T[1]), T2 = _mm256_set1_ps(p.T[2]);
+	const __m256 shift_x = _mm256_set1_ps(win.shift_x), shift_y = _mm256_set1_ps(win.shift_y);
+	const __m256 min_x = _mm256_set1_ps(win.min_x), max_x = _mm256_set1_ps(win.max_x);
+	const __m256 min_y = _mm256_set1_ps(win.min_y), max_y = _mm256_set1_ps(win.max_y);
+	const __m256 invalid = _mm256_set1_ps(WarpKernels::INVALID_COORDINATE);
+	const __m256 zero = _mm256_setzero_ps();
+	const __m256 all = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+
+	int x = 0;
+	for (; x <= n - 8; x += 8) {
+		__m256 sv = _mm256_loadu_ps(s + x);
+		__m256 cv = _mm256_loadu_ps(c + x);
+		__m256 u = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(P0, sv), _mm256_mul_ps(Q0, cv)), T0);
+		__m256 v = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(P1, sv), _mm256_mul_ps(Q1, cv)), T1);
+		__m256 w = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(P2, sv), _mm256_mul_ps(Q2, cv)), T2);
+
+		__m256 valid = p.checkBehindCamera ? _mm256_cmp_ps(w, zero, _CMP_GT_OQ) : all;
+		__m256 px = _mm256_add_ps(_mm256_div_ps(u, w), shift_x);
+		__m256 py = _mm256_add_ps(_mm256_div_ps(v, w), shift_y);
+
+		__m256 inside = _mm256_and_ps(
+			_mm256_and_ps(_mm256_cmp_ps(px, min_x, _CMP_GT_OQ), _mm256_cmp_ps(px, max_x, _CMP_LT_OQ)),
+			_mm256_and_ps(_mm256_cmp_ps(py, min_y, _CMP_GT_OQ), _mm256_cmp_ps(py, max_y, _CMP_LT_OQ)));
+		inside = _mm256_and_ps(inside, valid);
+
+		_mm256_storeu_ps(map_x + x, _mm256_blendv_ps(invalid, px, valid));
+		_mm256_storeu_ps(map_y + x, _mm256_blendv_ps(invalid, py, valid));
+
+		int bits = _mm256_movemask_ps(inside);
+		for (int k = 0; k < 8; k++)
+			mask[x + k] = ((bits >> k) & 1) ? 255 : 0;
+	}
+	return x;
+}
+
+/*
+	SSE version of the linear kernel: the rays of 4 pixels are stepped by 4 * P at each step.
+*/
+static int projectRowLinearSSE(const RowProjection& p, const SourceWindow& win,
+	float x0, int n, float* map_x, float* map_y, uchar* mask) {
+
+	const __m128 start = _mm_add_ps(_mm_set1_ps(x0), _mm_setr_ps(0, 1, 2, 3));
+	__m128 u = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(p.P[0]), start), _mm_set1_ps(p.T[0]));
+	__m128 v = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(p.P[1]), start), _mm_set1_ps(p.T[1]));
+	__m128 w = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(p.P[2]), start), _mm_set1_ps(p.T[2]));
+	const __m128 step_u = _mm_set1_ps(4 * p.P[0]);
+	const __m128 step_v = _mm_set1_ps(4 * p.P[1]);
+	const __m128 step_w = _mm_set1_ps(4 * p.P[2]);
+
+	const __m128 shift_x = _mm_set1_ps(win.shift_x), shift_y = _mm_set1_ps(win.shift_y);
+	const __m128 min_x = _mm_set1_ps(win.min_x), max_x = _mm_set1_ps(win.max_x);
+	const __m128 min_y = _mm_set1_ps(win.min_y), max_y = _mm_set1_ps(win.max_y);
+	const __m128 invalid = _mm_set1_ps(WarpKernels::INVALID_COORDINATE);
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 all = _mm_castsi128_ps(_mm_set1_epi32(-1));
+
+	int x = 0;
+	for (; x <= n - 4; x += 4) {
+		__m128 valid = p.checkBehindCamera ? _mm_cmpgt_ps(w, zero) : all;
+		__m128 px = _mm_add_ps(_mm_div_ps(u, w), shift_x);
+		__m128 py = _mm_add_ps(_mm_div_ps(v, w), shift_y);
+
+		__m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpgt_ps(px, min_x), _mm_cmplt_ps(px, max_x)),
+			_mm_and_ps(_mm_cmpgt_ps(py, min_y), _mm_cmplt_ps(py, max_y)));
+		inside = _mm_and_ps(inside, valid);
+
+		// SSE2 has no blend, the invalid points are selected with and/andnot.
+		px = _mm_or_ps(_mm_and_ps(valid, px), _mm_andnot_ps(valid, invalid));
+		py = _mm_or_ps(_mm_and_ps(valid, py), _mm_andnot_ps(valid, invalid));
+		_mm_storeu_ps(map_x + x, px);
+		_mm_storeu_ps(map_y + x, py);
+
+		int bits = _mm_movemask_ps(inside);
+		for (int k = 0; k < 4; k++)
+			mask[x + k] = ((bits >> k) & 1) ? 255 : 0;
+
+		u = _mm_add_ps(u, step_u);
+		v = _mm_add_ps(v, step_v);
+		w = _mm_add_ps(w, step_w);
+	}
+	return x;
+}
+
+/*
+	AVX2 version of the linear kernel: the rays of 8 pixels are stepped by 8 * P at each step.
+*/
+PANARUF_TARGET_AVX2
+static int projectRowLinearAVX2(const RowProjection& p, const SourceWindow& win,
+	float x0, int n, float* map_x, float* map_y, uchar* mask) {
+
+	const __m256 lanes = _mm256_setr_ps(0, 1, 2, 3, 4, 5, 6, 7);
+	const __m256 start = _mm256_add_ps(_mm256_set1_ps(x0), lanes);
+	__m256 u = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(p.P[0]), start), _mm256_set1_ps(p.T[0]));
+	__m256 v = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(p.P[1]), start), _mm256_set1_ps(p.T[1]));
+	__m256 w = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(p.P[2]), start), _mm256_set1_ps(p.T[2]));
+	const __m256 step_u = _mm256_set1_ps(8 * p.P[0]);
+	const __m256 step_v = _mm256_set1_ps(8 * p.P[1]);
+	const __m256 step_w = _mm256_set1_ps(8 * p.P[2]);
+
+	const __m256 shift_x = _mm256_set1_ps(win.shift_x), shift_y = _mm256_set1_ps(win.shift_y);
+	const __m256 min_x = _mm256_set1_ps(win.min_x), max_x = _mm256_set1_ps(win.max_x);
+	const __m256 min_y = _mm256_set1_ps(win.min_y), max_y = _mm256_set1_ps(win.max_y);
+	const __m256 invalid = _mm256_set1_ps(WarpKernels::INVALID_COORDINATE);
+	const __m256 zero = _mm256_setzero_ps();
+	const __m256 all = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+
+	int x = 0;
+	for (; x <= n - 8; x += 8) {
+		__m256 valid = p.checkBehindCamera ? _mm256_cmp_ps(w, zero, _CMP_GT_OQ) : all;
+		__m256 px = _mm256_add_ps(_mm256_div_ps(u, w), shift_x);
+		__m256 py = _mm256_add_ps(_mm256_div_ps(v, w), shift_y);
+
+		__m256 inside = _mm256_and_ps(
+			_mm256_and_ps(_mm256_cmp_ps(px, min_x, _CMP_GT_OQ), _mm256_cmp_ps(px, max_x, _CMP_LT_OQ)),
+			_mm256_and_ps(_mm256_cmp_ps(py, min_y, _CMP_GT_OQ), _mm256_cmp_ps(py, max_y, _CMP_LT_OQ)));
+		inside = _mm256_and_ps(inside, valid);
+
+		_mm256_storeu_ps(map_x + x, _mm256_blendv_ps(invalid, px, valid));
+		_mm256_storeu_ps(map_y + x, _mm256_blendv_ps(invalid, py, valid));
+
+		int bits = _mm256_movemask_ps(inside);
+		for (int k = 0; k < 8; k++)
+			mask[x + k] = ((bits >> k) & 1) ? 255 : 0;
+
+		u = _mm256_add_ps(u, step_u);
+		v = _mm256_add_ps(v, step_v);
+		w = _mm256_add_ps(w, step_w);
+	}
+	return x;
+}
+
+#endif
+
+void WarpKernels::projectRow(const RowProjection& projection, const SourceWindow& window,
+	const float* s, const float* c, int n, float* map_x, float* map_y, uchar* mask) {
+
+	int x = 0;
+#ifdef PANARUF_X86
+	if (checkHardwareSupport(CV_CPU_AVX2))
+		x = projectRowAVX2(projection, window, s, c, n, map_x, map_y, mask);
+	else if (checkHardwareSupport(CV_CPU_SSE2))
+		x = projectRowSSE(projection, window, s, c, n, map_x, map_y, mask);
+#endif
+	// the remaining pixels of the row.
+	projectRowScalar(projection, window, s, c, x, n, map_x, map_y, mask);
+}
+
+void WarpKernels::projectRowLinear(const RowProjection& projection, const SourceWindow& window,
+	float x0, int n, float* map_x, float* map_y, uchar* mask) {
+
+	int x = 0;
+#ifdef PANARUF_X86
+	if (checkHardwareSupport(CV_CPU_AVX2))
+		x = projectRowLinearAVX2(projection, window, x0, n, map_x, map_y, mask);
+	else if (checkHardwareSupport(CV_CPU_SSE2))
+		x = projectRowLinearSSE(projection, window, x0, n, map_x, map_y, mask);
+#endif
+	// the remaining pixels of the row.
+	projectRowLinearScalar(projection, window, x0, x, n, map_x, map_y, mask);
+}
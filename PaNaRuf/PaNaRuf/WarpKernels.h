@@ -0,0 +1,72 @@
+#ifndef  WARP_KERNELS_H
+#define  WARP_KERNELS_H
+
+#include <iostream>
+#include <opencv2/core.hpp>
+
+using namespace std;
+using namespace cv;
+
+/*
+	Projection of one destination row to the source image.
+	All of the warpings can be written in the following form for a single row:
+		(u, v, w) = P * s[x] + Q * c[x] + T
+		source point = (u / w, v / w)
+	* perspective : s[x] = x, Q = 0, P and T come from the inverse homography.
+	* cylindrical : s[x] = sin(theta), c[x] = cos(theta), T depends on the height of the row.
+	* spherical   : s[x] = sin(theta), c[x] = cos(theta), P, Q and T depend on phi of the row.
+	* checkBehindCamera -> if it is true, the points with w <= 0 (beyond camera) are not taken.
+*/
+struct RowProjection {
+	float P[3];
+	float Q[3];
+	float T[3];
+	bool checkBehindCamera;
+};
+
+/*
+	The window of the source image:
+	* shift_x, shift_y -> added to each projected point.
+	* (min_x, max_x), (min_y, max_y) -> the mask is set only if the shifted point is within these (exclusive) borders.
+*/
+struct SourceWindow {
+	float shift_x;
+	float shift_y;
+	float min_x;
+	float max_x;
+	float min_y;
+	float max_y;
+};
+
+/*
+	The pixel kernels of the warping operations.
+	They work on plain arrays (no cv::Mat per pixel), keep the projection in registers
+	and process 8 pixels at a time with AVX2 (or SSE if AVX2 is not supported by the CPU).
+*/
+class WarpKernels {
+
+public:
+	/*
+		Source coordinate given to the destination pixels which have no corresponding source pixel.
+		It is far outside of the source image (also of its mirrored images), so the resampling gives black color to those pixels.
+		In the fixed-point maps it becomes Sampler::INVALID_INDEX (see WarpMap::convertToFixedPoint).
+	*/
+	static const float INVALID_COORDINATE;
+
+	/*
+		Projects n destination pixels of a row to the source image and writes
+		the source coordinates to map_x, map_y and the mask to "mask".
+	*/
+	void projectRow(const RowProjection& projection, const SourceWindow& window,
+		const float* s, const float* c, int n, float* map_x, float* map_y, uchar* mask);
+
+	/*
+		Same as "projectRow" for the linear case (Q = 0, s[x] = x0 + x) of perspective warping.
+		The ray (u, v, w) is computed once at x0 and then stepped by P along the row,
+		instead of multiplying at each pixel.
+	*/
+	void projectRowLinear(const RowProjection& projection, const SourceWindow& window,
+		float x0, int n, float* map_x, float* map_y, uchar* mask);
+};
+
+#endif
@@ -0,0 +1,74 @@
+#include "WarpMap.h"
+
+bool WarpMap::isFixedPoint() const {
+	return !map_xy.empty();
+}
+
+void WarpMap::convertToFixedPoint() {
+	if (isFixedPoint() || map_x.empty())
+		return;
+
+	// map_xy gets the integer coordinates, map_frac gets the interpolation table indices.
+	convertMaps(map_x, map_y, map_xy, map_frac, CV_16SC2, false);
+
+	/*
+		The coordinates which do not fit in int16 (the invalid points of the kernels, or NaN) are saturated by convertMaps,
+		and a saturated coordinate may fall back inside of a large image when it is mirrored. They are marked as invalid.
+	*/
+	for (int y = 0; y < map_x.rows; y++) {
+		const float* xs = map_x.ptr<float>(y);
+		const float* ys = map_y.ptr<float>(y);
+		short* xy = map_xy.ptr<short>(y);
+		for (int x = 0; x < map_x.cols; x++) {
+			if (!(xs[x] > SHRT_MIN && xs[x] < SHRT_MAX && ys[x] > SHRT_MIN && ys[x] < SHRT_MAX))
+				xy[2 * x] = xy[2 * x + 1] = Sampler::INVALID_INDEX;
+		}
+	}
+	map_x.release();
+	map_y.release();
+}
+
+size_t WarpMap::sizeInBytes() const {
+	return map_x.total() * map_x.elemSize() + map_y.total() * map_y.elemSize()
+		+ map_xy.total() * map_xy.elemSize() + map_frac.total() * map_frac.elemSize()
+		+ mask.total() * mask.elemSize();
+}
+
+void WarpMap::save(const string& file_name) const {
+	// BASE64 keeps the matrices compact inside the file.
+	FileStorage fs(file_name, FileStorage::WRITE | FileStorage::BASE64);
+	fs << "roi" << roi;
+	fs << "sourceSize" << sourceSize;
+	if (isFixedPoint()) {
+		fs << "map_xy" << map_xy;
+		fs << "map_frac" << map_frac;
+	}
+	else {
+		fs << "map_x" << map_x;
+		fs << "map_y" << map_y;
+	}
+	fs << "mask" << mask;
+	fs.release();
+}
+
+bool WarpMap::load(const string& file_name) {
+	FileStorage fs;
+	try {
+		if (!fs.open(file_name, FileStorage::READ))
+			return false;
+	}
+	catch (cv::Exception e) {
+		return false;
+	}
+
+	fs["roi"] >> roi;
+	fs["sourceSize"] >> sourceSize;
+	fs["map_xy"] >> map_xy;
+	fs["map_frac"] >> map_frac;
+	fs["map_x"] >> map_x;
+	fs["map_y"] >> map_y;
+	fs["mask"] >> mask;
+	fs.release();
+
+	return !mask.empty() && (isFixedPoint() || !map_x.empty());
+}
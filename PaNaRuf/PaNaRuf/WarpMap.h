@@ -0,0 +1,61 @@
+#ifndef  WARP_MAP_H
+#define  WARP_MAP_H
+
+#include <iostream>
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+#include "Sampler.h"
+
+using namespace std;
+using namespace cv;
+
+/*
+	This class represents the backward mapping of a warped (destination) image:
+	for each destination pixel it stores the source image coordinate to sample from.
+	* roi -> the destination image area (top-left corner and size).
+	* sourceSize -> size of the source image the coordinates refer to.
+	* map_x, map_y -> float source coordinates (CV_32F), used when the map is not fixed-point.
+	* map_xy, map_frac -> fixed-point source coordinates: integer part (CV_16SC2) and
+	  the index of the fractional part in the interpolation table (CV_16UC1).
+	  The points without a source pixel are at Sampler::INVALID_INDEX.
+	* mask -> destination mask (CV_8U), 255 if the pixel is covered by the source image.
+
+	Since the map only depends on the camera parameters and on the roi, it can be computed once
+	and re-used (or saved to/loaded from a file) for each image taken with the same parameters.
+*/
+class WarpMap {
+
+public:
+	Rect roi;
+	Size sourceSize;
+	Mat map_x;
+	Mat map_y;
+	Mat map_xy;
+	Mat map_frac;
+	Mat mask;
+
+	/*
+		Returns true if the source coordinates are stored in fixed-point (int16 + fraction) format.
+	*/
+	bool isFixedPoint() const;
+
+	/*
+		Converts float coordinates to the compact fixed-point format and frees the float maps.
+	*/
+	void convertToFixedPoint();
+
+	/*
+		Returns the number of bytes used by the maps and the mask.
+	*/
+	size_t sizeInBytes() const;
+
+	/*
+		Saves the map to the file / loads the map from the file.
+		"load" returns false if the file does not exist or does not contain a map.
+	*/
+	void save(const string& file_name) const;
+
+	bool load(const string& file_name);
+};
+
+#endif
@@ -0,0 +1,550 @@
+#include "WarpMapper.h"
+#include <sstream>
+#include <iomanip>
+#include <functional>
+#include <cfloat>
+#include <climits>
+
+/*
+	Forward mapping of the source image point (i, j) to the destination image.
+	* M is Rinv_Kinv for the camera based types, and H for perspective warping.
+	* MERCATOR gives the latitude like SPHERICAL (see findRoi).
+	The point is NaN if the ray is outside of the domain of the projection.
+*/
+static inline Point2d forwardPoint(PanoramaType type, const double* M, double fx, double fy, double i, double j) {
+	double X = M[0] * i + M[1] * j + M[2];
+	double Y = M[3] * i + M[4] * j + M[5];
+	double Z = M[6] * i + M[7] * j + M[8];
+
+	double x = NAN, y = NAN;
+	switch (type) {
+	case(CYLINDRICAL):
+		// theta and height on the unit cylinder.
+		CylindricalProjection::project(X, Y, Z, x, y);
+		return Point2d(fx * x, fy * y);
+	case(SPHERICAL):
+	case(MERCATOR):
+		// longitude and latitude (theta and phi) on the unit sphere.
+		SphericalProjection::project(X, Y, Z, x, y);
+		return Point2d(fx * x, fy * y);
+	case(PLANAR):
+		if (!PlanarProjection::project(X, Y, Z, x, y))
+			return Point2d(NAN, NAN);
+		return Point2d(fx * x, fy * y);
+	case(STEREOGRAPHIC):
+		if (!StereographicProjection::project(X, Y, Z, x, y))
+			return Point2d(NAN, NAN);
+		return Point2d(fx * x, fy * y);
+	case(EQUISOLID):
+		if (!EquisolidProjection::project(X, Y, Z, x, y))
+			return Point2d(NAN, NAN);
+		return Point2d(fx * x, fy * y);
+	default:
+		return Point2d(X / Z, Y / Z);
+	}
+}
+
+/*
+	Rounds the destination points to the integer top-left and bottom-right points.
+	The values are limited to avoid integer overflow for the points at (almost) infinity.
+*/
+static inline Rect roundRoi(double min_x, double min_y, double max_x, double max_y) {
+	const double limit = INT_MAX / 4;
+	if (min_x > max_x || min_y > max_y)
+		return Rect(Point(0, 0), Point(0, 0));
+	Point2i topLeft((int)round(max(min_x, -limit)), (int)round(max(min_y, -limit)));
+	Point2i bottomRight((int)round(min(max_x, limit)), (int)round(min(max_y, limit)));
+	return Rect(topLeft, bottomRight);
+}
+
+WarpMapper::WarpMapper() {
+	sampler.borderMode = BORDER_REFLECT;
+}
+
+Rect WarpMapper::findRoi(PanoramaType type, Size imageSize, Mat K, Mat R) {
+	int w = imageSize.width; // width of the source image
+	int h = imageSize.height; // height of the source image
+	if (w == 0 || h == 0)
+		return Rect(Point(0, 0), Point(0, 0));
+
+	if (type == NONE)
+		return Rect(Point(0, 0), Point(0, 0));
+
+	double fx = 1, fy = 1;
+	Mat M_mat;
+	if (type == PERSPECTIVE) {
+		M_mat = R.clone();
+	}
+	else {
+		fx = K.at<double>(0, 0);
+		fy = K.at<double>(1, 1);
+		M_mat = R.inv() * K.inv();
+	}
+	const double* M = M_mat.ptr<double>(0);
+
+	// planar, stereographic and equisolid : the projection has no pole and no seam.
+	bool azimuthal = type == PLANAR || type == STEREOGRAPHIC || type == EQUISOLID;
+
+	bool poles[2] = { false, false };
+	if (azimuthal) {
+		/*
+			These projections map the sphere (without the area excluded by the policy) to the plane without
+			any critical point, so the extreme points are on the border if the whole image is in the domain.
+			The image (seen by a camera) is convex on the sphere, and so is the domain of the planar projection.
+			The excluded area of the stereographic and equisolid projections is around the opposite of the panorama
+			axis (0, 0, -1): if it reaches the image without crossing its border, this point is seen by the camera.
+		*/
+		if (type != PLANAR) {
+			Mat KR = K * R;
+			double u = -KR.at<double>(0, 2);
+			double v = -KR.at<double>(1, 2);
+			double z = -KR.at<double>(2, 2);
+			if (z > 0 && u / z >= 0 && u / z <= w - 1 && v / z >= 0 && v / z <= h - 1)
+				return scanRoi(type, imageSize, M, fx, fy);
+		}
+	}
+	else if (type == PERSPECTIVE) {
+		/*
+			w of the homography changes linearly, so if it is positive at the 4 corners, it is positive in the whole image.
+			Otherwise the horizon is within the image and the border does not bound the destination area.
+		*/
+		for (int k = 0; k < 4; k++) {
+			double i = (k & 1) ? w - 1 : 0;
+			double j = (k & 2) ? h - 1 : 0;
+			if (M[6] * i + M[7] * j + M[8] <= 0)
+				return scanRoi(type, imageSize, M, fx, fy);
+		}
+	}
+	else {
+		/*
+			The poles (0, +-1, 0) are the only points where theta and phi (or height) can have extreme values
+			inside of the image. If a pole is seen by the camera, then:
+			* spherical : the image covers all longitudes and reaches +-pi/2 latitude at this pole.
+			* cylindrical : the height goes to infinity, so all pixels are projected.
+		*/
+		Mat KR = K * R;
+		for (int k = 0; k < 2; k++) {
+			double sign = (k == 0) ? 1.0 : -1.0;
+			double u = KR.at<double>(0, 1) * sign;
+			double v = KR.at<double>(1, 1) * sign;
+			double z = KR.at<double>(2, 1) * sign;
+			poles[k] = z > 0 && u / z >= 0 && u / z <= w - 1 && v / z >= 0 && v / z <= h - 1;
+		}
+		if (type == CYLINDRICAL && (poles[0] || poles[1]))
+			return scanRoi(type, imageSize, M, fx, fy);
+	}
+
+	/*
+		Walk over the border of the source image (top, right, bottom, left; as a closed loop)
+		and apply the forward mapping to get the destination image points.
+	*/
+	vector<Point2d> border;
+	border.reserve(2 * (w + h));
+	for (int i = 0; i < w; i++) border.push_back(Point2d(i, 0));
+	for (int j = 0; j < h; j++) border.push_back(Point2d(w - 1, j));
+	for (int i = w - 1; i >= 0; i--) border.push_back(Point2d(i, h - 1));
+	for (int j = h - 1; j >= 0; j--) border.push_back(Point2d(0, j));
+
+	double min_x = DBL_MAX, min_y = DBL_MAX, max_x = -DBL_MAX, max_y = -DBL_MAX;
+	double previous_x = 0;
+	bool seam = false;
+	for (int k = 0; k < border.size(); k++) {
+		Point2d p = forwardPoint(type, M, fx, fy, border[k].x, border[k].y);
+		if (cvIsNaN(p.x) || cvIsNaN(p.y)) {
+			// the border leaves the domain of the projection, so it does not bound the destination area.
+			if (azimuthal)
+				return scanRoi(type, imageSize, M, fx, fy);
+			continue;
+		}
+
+		/*
+			If theta jumps by more than pi between two neighbouring border points,
+			the +-pi seam crosses the image: then the image covers theta = -pi and theta = pi.
+		*/
+		if (type != PERSPECTIVE && !azimuthal && k > 0 && fabs(p.x - previous_x) > CV_PI * fx)
+			seam = true;
+		previous_x = p.x;
+
+		min_x = min(min_x, p.x);
+		min_y = min(min_y, p.y);
+		max_x = max(max_x, p.x);
+		max_y = max(max_y, p.y);
+	}
+
+	// A pole within the image : all longitudes, and +-pi/2 latitude at this pole.
+	if (poles[0] || poles[1]) {
+		seam = true;
+		if (poles[0])
+			max_y = CV_PI / 2 * fy;
+		if (poles[1])
+			min_y = -CV_PI / 2 * fy;
+	}
+
+	if (seam) {
+		min_x = -CV_PI * fx;
+		max_x = CV_PI * fx;
+	}
+
+	// the Mercator y is an increasing function of the latitude, limited to +-pi (see MercatorProjection).
+	if (type == MERCATOR && min_x <= max_x) {
+		min_y = max(-CV_PI, min(CV_PI, asinh(tan(min_y / fy)))) * fy;
+		max_y = max(-CV_PI, min(CV_PI, asinh(tan(max_y / fy)))) * fy;
+	}
+
+	return roundRoi(min_x, min_y, max_x, max_y);
+}
+
+Rect WarpMapper::scanRoi(PanoramaType type, Size imageSize, const double* M, double fx, double fy) {
+	double min_x = DBL_MAX, min_y = DBL_MAX, max_x = -DBL_MAX, max_y = -DBL_MAX;
+
+#pragma omp parallel
+	{
+		// minimum and maximum points found by the current thread.
+		double t_min_x = DBL_MAX, t_min_y = DBL_MAX, t_max_x = -DBL_MAX, t_max_y = -DBL_MAX;
+
+#pragma omp for
+		for (int j = 0; j < imageSize.height; j++) {
+			for (int i = 0; i < imageSize.width; i++) {
+				Point2d p = forwardPoint(type, M, fx, fy, i, j);
+				if (cvIsNaN(p.x) || cvIsNaN(p.y))
+					continue;
+				t_min_x = min(t_min_x, p.x);
+				t_min_y = min(t_min_y, p.y);
+				t_max_x = max(t_max_x, p.x);
+				t_max_y = max(t_max_y, p.y);
+			}
+		}
+
+		// only one thread can merge its result at a time (once per thread, not per pixel).
+#pragma omp critical
+		{
+			min_x = min(min_x, t_min_x);
+			min_y = min(min_y, t_min_y);
+			max_x = max(max_x, t_max_x);
+			max_y = max(max_y, t_max_y);
+		}
+	}
+
+	return roundRoi(min_x, min_y, max_x, max_y);
+}
+
+WarpMap WarpMapper::getMap(PanoramaType type, Size sourceSize, Rect roi, Mat K, Mat R) {
+	string key = createKey(type, sourceSize, roi, K, R);
+
+	/*
+		Several images can be warped at the same time (see WarpScheduler),
+		therefore the cache is accessed by one thread at a time.
+	*/
+	WarpMap warpMap;
+	bool cached = false;
+#pragma omp critical(warp_map_cache)
+	{
+		map<string, WarpMap>::iterator it = cache.find(key);
+		if (it != cache.end()) {
+			warpMap = it->second;
+			cached = true;
+		}
+	}
+	if (cached)
+		return warpMap;
+
+	string file_name;
+	if (!mapsDirectory.empty())
+		file_name = mapsDirectory + "/map_" + to_string(std::hash<string>()(key)) + ".yml.gz";
+
+	// Try to load the map computed in one of the previous runs.
+	bool loaded = !file_name.empty() && warpMap.load(file_name) &&
+		warpMap.roi == roi && warpMap.sourceSize == sourceSize;
+
+	if (!loaded) {
+		if (type == NONE)
+			return warpMap;
+		else if (type == PERSPECTIVE)
+			buildPerspectiveMap(sourceSize, roi, R, warpMap);
+		else
+			buildMap(type, sourceSize, roi, K, R, warpMap);
+
+		if (useFixedPoint)
+			warpMap.convertToFixedPoint();
+
+		if (!file_name.empty())
+			warpMap.save(file_name);
+	}
+
+#pragma omp critical(warp_map_cache)
+	{
+		if (cache.find(key) == cache.end() && cacheBytes + warpMap.sizeInBytes() <= cacheLimitBytes) {
+			cache[key] = warpMap;
+			cacheBytes += warpMap.sizeInBytes();
+		}
+	}
+	return warpMap;
+}
+
+void WarpMapper::buildMap(PanoramaType type, Size sourceSize, Rect roi, Mat K, Mat R, WarpMap& warpMap) {
+	prepareMap(sourceSize, roi, warpMap);
+	SourceWindow window = getSourceWindow(sourceSize);
+
+	// the projection math of each type is inlined into its own instance of the engine.
+	switch (type) {
+	case(CYLINDRICAL):
+		// level cameras (reference image, tripod pans) have a separable map.
+		if (isYawOnly(K, R))
+			buildYawCylindricalMap(roi, K, R, window, warpMap);
+		else
+			WarpEngine<CylindricalProjection>::buildMap(roi, K, R, window, kernels, scheduler, warpMap);
+		break;
+	case(SPHERICAL):
+		WarpEngine<SphericalProjection>::buildMap(roi, K, R, window, kernels, scheduler, warpMap);
+		break;
+	case(PLANAR):
+		WarpEngine<PlanarProjection>::buildMap(roi, K, R, window, kernels, scheduler, warpMap);
+		break;
+	case(STEREOGRAPHIC):
+		WarpEngine<StereographicProjection>::buildMap(roi, K, R, window, kernels, scheduler, warpMap);
+		break;
+	case(MERCATOR):
+		WarpEngine<MercatorProjection>::buildMap(roi, K, R, window, kernels, scheduler, warpMap);
+		break;
+	case(EQUISOLID):
+		WarpEngine<EquisolidProjection>::buildMap(roi, K, R, window, kernels, scheduler, warpMap);
+		break;
+	default:
+		break;
+	}
+}
+
+bool WarpMapper::isYawOnly(Mat K, Mat R) {
+	double fx = K.at<double>(0, 0);
+	double fy = K.at<double>(1, 1);
+	double tolerance = 1e-3 / max(fabs(fx), fabs(fy));
+
+	bool noSkew = K.at<double>(0, 1) == 0 && K.at<double>(1, 0) == 0 &&
+		K.at<double>(2, 0) == 0 && K.at<double>(2, 1) == 0 && K.at<double>(2, 2) == 1;
+	bool level = fabs(R.at<double>(1, 1) - 1.0) < tolerance &&
+		fabs(R.at<double>(0, 1)) < tolerance && fabs(R.at<double>(1, 0)) < tolerance &&
+		fabs(R.at<double>(1, 2)) < tolerance && fabs(R.at<double>(2, 1)) < tolerance;
+
+	/*
+		The x-z block must be a rotation Ry(alpha) as well : [c s; -s c] with c^2 + s^2 = 1 and a positive determinant,
+		otherwise (a mirrored or not normalized R) the general engine is used.
+	*/
+	double c = R.at<double>(0, 0), s = R.at<double>(0, 2);
+	bool rotation = fabs(R.at<double>(2, 2) - c) < tolerance && fabs(R.at<double>(2, 0) + s) < tolerance &&
+		fabs(c * c + s * s - 1.0) < tolerance && determinant(R) > 0;
+	return noSkew && level && rotation;
+}
+
+void WarpMapper::buildYawCylindricalMap(Rect roi, Mat K, Mat R, const SourceWindow& window, WarpMap& warpMap) {
+	int wd = roi.br().x - roi.tl().x; // width of destination (cylindrical) image.
+	int hd = roi.br().y - roi.tl().y; // height of destination (cylindrical) image.
+
+	// offset is used to shift the cylindrical image point to actual point in x-y image coordinates.
+	Point2d offset = 0.5 * Point2d((roi.tl() + roi.br())) - Point2d(double(wd) * 0.5, double(hd) * 0.5);
+
+	double fx = K.at<double>(0, 0);
+	double fy = K.at<double>(1, 1);
+	double cx = K.at<double>(0, 2);
+	double cy = K.at<double>(1, 2);
+
+	// R * (sin(theta), h, cos(theta)) = (sin(theta + alpha), h, cos(theta + alpha))
+	double alpha = atan2(R.at<double>(0, 2), R.at<double>(0, 0));
+
+	/*
+		1D tables of the columns:
+		* u -> source x (shifted), the same for all rows.
+		* inv_cos -> 1 / cos(theta + alpha), the scale of the row height.
+		* column_mask -> 255 if the column is in front of the camera and within the source image horizontally.
+	*/
+	vector<float> u(wd), inv_cos(wd);
+	vector<uchar> column_mask(wd);
+	for (int x = 0; x < wd; x++) {
+		double angle = (x + offset.x) / fx + alpha;
+		double c = cos(angle);
+		if (c <= 0) {
+			u[x] = WarpKernels::INVALID_COORDINATE;
+			inv_cos[x] = 0;
+			column_mask[x] = 0;
+			continue;
+		}
+		u[x] = (float)(fx * tan(angle) + cx + window.shift_x);
+		inv_cos[x] = (float)(1.0 / c);
+		column_mask[x] = (u[x] > window.min_x && u[x] < window.max_x) ? 255 : 0;
+	}
+
+	scheduler.run(roi.size(), [&](const Rect& tile) {
+		for (int y = tile.y; y < tile.y + tile.height; y++) {
+			// fy * h, where h is the height on the unit cylinder.
+			float height = (float)(y + offset.y);
+			float v0 = (float)(cy + window.shift_y);
+			float* map_x = warpMap.map_x.ptr<float>(y);
+			float* map_y = warpMap.map_y.ptr<float>(y);
+			uchar* mask = warpMap.mask.ptr<uchar>(y);
+
+			for (int x = tile.x; x < tile.x + tile.width; x++) {
+				float v = height * inv_cos[x] + v0;
+				map_x[x] = u[x];
+				map_y[x] = (inv_cos[x] > 0) ? v : WarpKernels::INVALID_COORDINATE;
+				mask[x] = (column_mask[x] && v > window.min_y && v < window.max_y) ? 255 : 0;
+			}
+		}
+	});
+}
+
+void WarpMapper::buildPerspectiveMap(Size sourceSize, Rect roi, Mat H, WarpMap& warpMap) {
+	int wd = roi.br().x - roi.tl().x; // width of warped (destination) image.
+	int hd = roi.br().y - roi.tl().y; // height of warped (destination) image.
+
+	// offset is used to shift the warped (dest) image point to actual point in x-y image coordinates.
+	Point2d offset = 0.5 * Point2d((roi.tl() + roi.br())) - Point2d(double(wd) * 0.5, double(hd) * 0.5);
+
+	prepareMap(sourceSize, roi, warpMap);
+	SourceWindow window = getSourceWindow(sourceSize);
+
+	// The inverse homography is computed once, instead of at each pixel.
+	Mat Hinv = H.inv();
+
+	// The destination image is processed tile by tile, each tile row by row.
+	scheduler.run(roi.size(), [&](const Rect& tile) {
+		for (int y = tile.y; y < tile.y + tile.height; y++) {
+			double Y = y + offset.y;
+
+			/*
+				(u, v, w) = Hinv * (x + offset.x, Y, 1) : the ray is computed at the first pixel of the tile row
+				and then stepped by the first column of Hinv along the row.
+			*/
+			RowProjection projection;
+			for (int i = 0; i < 3; i++) {
+				projection.P[i] = (float)Hinv.at<double>(i, 0);
+				projection.Q[i] = 0.0f;
+				projection.T[i] = (float)(Hinv.at<double>(i, 0) * (tile.x + offset.x) + Hinv.at<double>(i, 1) * Y + Hinv.at<double>(i, 2));
+			}
+			projection.checkBehindCamera = false;
+
+			kernels.projectRowLinear(projection, window, 0.0f, tile.width,
+				warpMap.map_x.ptr<float>(y) + tile.x, warpMap.map_y.ptr<float>(y) + tile.x, warpMap.mask.ptr<uchar>(y) + tile.x);
+		}
+	});
+}
+
+void WarpMapper::apply(const Mat& image, const WarpMap& warpMap, Mat& warped_image, Mat& warped_mask, const Mat& gains) {
+	warped_image = Mat(warpMap.roi.size(), CV_8UC3);
+	Size size = warpMap.roi.size();
+
+	/*
+		Bilinear interpolation of the source image at the mapped points, tile by tile.
+		The points outside of the source image get black color.
+	*/
+	scheduler.run(size, [&](const Rect& tile) {
+		vector<ushort> row_gains(gains.empty() ? 0 : tile.width);
+		for (int y = tile.y; y < tile.y + tile.height; y++) {
+			const ushort* g = 0;
+			if (!gains.empty()) {
+				interpolateGains(gains, size, y, tile.x, tile.width, row_gains.data());
+				g = row_gains.data();
+			}
+
+			uchar* dst = warped_image.ptr<uchar>(y) + 3 * tile.x;
+			if (warpMap.isFixedPoint())
+				sampler.sampleBatchFixed(image, warpMap.map_xy.ptr<short>(y) + 2 * tile.x, warpMap.map_frac.ptr<ushort>(y) + tile.x, tile.width, dst, g);
+			else
+				sampler.sampleBatch(image, warpMap.map_x.ptr<float>(y) + tile.x, warpMap.map_y.ptr<float>(y) + tile.x, tile.width, dst, g);
+		}
+	});
+
+	// The mask is copied, since the blending modifies the warped masks.
+	warpMap.mask.copyTo(warped_mask);
+}
+
+void WarpMapper::composite(const Mat& image, const WarpMap& warpMap, Mat& sum, Mat& weight_sum, Point offset,
+	const Mat& gains, Rect roi) {
+	float width = (float)image.cols;
+	float height = (float)image.rows;
+	vector<uchar> samples(3 * warpMap.roi.width);
+	vector<ushort> row_gains(gains.empty() ? 0 : warpMap.roi.width);
+
+	// position of the warp map within the area of the gain map.
+	Point origin = warpMap.roi.tl() - roi.tl();
+
+	for (int y = 0; y < warpMap.roi.height; y++) {
+		const float* map_x = warpMap.map_x.ptr<float>(y);
+		const float* map_y = warpMap.map_y.ptr<float>(y);
+		const uchar* mask = warpMap.mask.ptr<uchar>(y);
+		const ushort* g = 0;
+		if (!gains.empty()) {
+			interpolateGains(gains, roi.size(), origin.y + y, origin.x, warpMap.roi.width, row_gains.data());
+			g = row_gains.data();
+		}
+		sampler.sampleBatch(image, map_x, map_y, warpMap.roi.width, samples.data(), g);
+
+		float* dst = sum.ptr<float>(offset.y + y) + 3 * offset.x;
+		float* w = weight_sum.ptr<float>(offset.y + y) + offset.x;
+		for (int x = 0; x < warpMap.roi.width; x++) {
+			if (!mask[x])
+				continue;
+			// the weight grows linearly from the border of the source image.
+			float weight = min(min(map_x[x] + 1.0f, width - map_x[x]), min(map_y[x] + 1.0f, height - map_y[x]));
+			dst[3 * x] += weight * samples[3 * x];
+			dst[3 * x + 1] += weight * samples[3 * x + 1];
+			dst[3 * x + 2] += weight * samples[3 * x + 2];
+			w[x] += weight;
+		}
+	}
+}
+
+void WarpMapper::interpolateGains(const Mat& gains, Size size, int y, int x, int width, ushort* row_gains) {
+	float gy = min(max((y + 0.5f) * gains.rows / size.height - 0.5f, 0.0f), (float)(gains.rows - 1));
+	int y0 = (int)gy, y1 = min(y0 + 1, gains.rows - 1);
+	float fy = gy - y0;
+	for (int k = 0; k < width; k++) {
+		float gx = min(max((x + k + 0.5f) * gains.cols / size.width - 0.5f, 0.0f), (float)(gains.cols - 1));
+		int x0 = (int)gx, x1 = min(x0 + 1, gains.cols - 1);
+		float fx = gx - x0;
+		float gain = (1 - fy) * ((1 - fx) * gains.at<float>(y0, x0) + fx * gains.at<float>(y0, x1))
+			+ fy * ((1 - fx) * gains.at<float>(y1, x0) + fx * gains.at<float>(y1, x1));
+		row_gains[k] = saturate_cast<ushort>(gain * (1 << Sampler::GAIN_BITS));
+	}
+}
+
+void WarpMapper::prepareMap(Size sourceSize, Rect roi, WarpMap& warpMap) {
+	warpMap.roi = roi;
+	warpMap.sourceSize = sourceSize;
+	warpMap.map_x = Mat(roi.size(), CV_32F);
+	warpMap.map_y = Mat(roi.size(), CV_32F);
+	warpMap.mask = Mat(roi.size(), CV_8U);
+}
+
+SourceWindow WarpMapper::getSourceWindow(Size sourceSize) {
+	/*
+		The mask is set only if the point is within the source image.
+		(the points around the image are still sampled from the virtually mirrored image)
+	*/
+	SourceWindow window;
+	window.shift_x = 0.0f;
+	window.shift_y = 0.0f;
+	window.min_x = 0.0f;
+	window.max_x = (float)(sourceSize.width - 1);
+	window.min_y = 0.0f;
+	window.max_y = (float)(sourceSize.height - 1);
+	return window;
+}
+
+void WarpMapper::clearCache() {
+	cache.clear();
+	cacheBytes = 0;
+}
+
+string WarpMapper::createKey(PanoramaType type, Size sourceSize, Rect roi, Mat K, Mat R) {
+	ostringstream key;
+	key << setprecision(17) << type << "_" << sourceSize.width << "x" << sourceSize.height
+		<< "_" << roi.x << "_" << roi.y << "_" << roi.width << "x" << roi.height;
+
+	if (!K.empty())
+		for (int i = 0; i < 9; i++)
+			key << "_" << K.at<double>(i / 3, i % 3);
+	if (!R.empty())
+		for (int i = 0; i < 9; i++)
+			key << "_" << R.at<double>(i / 3, i % 3);
+
+	return key.str();
+}
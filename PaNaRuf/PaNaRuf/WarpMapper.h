@@ -0,0 +1,151 @@
+#ifndef  WARP_MAPPER_H
+#define  WARP_MAPPER_H
+
+#include <iostream>
+#include <map>
+#include <omp.h>
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+#include "PanoramaType.h"
+#include "WarpMap.h"
+#include "WarpKernels.h"
+#include "TileScheduler.h"
+#include "Sampler.h"
+#include "FastMath.h"
+#include "WarpEngine.h"
+
+using namespace std;
+using namespace cv;
+
+/*
+	This class computes the backward warp maps of cylindrical, spherical and perspective warping
+	and applies them to the source images.
+
+	The maps are computed once for each (panorama type, K, R, roi, source size) and kept
+	in memory, therefore the geometry cost is paid only once and the later warps only resample
+	the source image. If "mapsDirectory" is set, the maps are also saved to / loaded from that directory.
+*/
+class WarpMapper {
+
+public:
+	WarpMapper();
+
+	// If it is true, the maps are stored in the compact fixed-point format (int16 + fraction).
+	bool useFixedPoint = true;
+
+	// If it is not empty, the maps are saved to/loaded from this directory.
+	string mapsDirectory = "";
+
+	// The maps are not kept in memory anymore when the total size of the cache exceeds this limit.
+	size_t cacheLimitBytes = size_t(1024) * 1024 * 1024;
+
+	/*
+		Returns the warp map of the given type (computes it if it is not in the cache).
+		It can be called by several threads at the same time.
+		* sourceSize -> size of the source image.
+		* roi -> destination image area found by the forward warping.
+		* For PERSPECTIVE, K is not used and R is the homography matrix H of the image.
+	*/
+	WarpMap getMap(PanoramaType type, Size sourceSize, Rect roi, Mat K, Mat R);
+
+	/*
+		Forward warping: finds the destination image area (roi) of a source image of the given size.
+		Instead of projecting all source pixels, only the border of the source image is projected,
+		since the extreme points are on the border except at the poles and at the +-pi seam,
+		which are checked analytically. A full scan is applied only if the destination area is
+		not bounded by the border (e.g. a pole of the cylinder is within the image).
+		* For PERSPECTIVE, K is not used and R is the homography matrix H of the image.
+	*/
+	Rect findRoi(PanoramaType type, Size imageSize, Mat K, Mat R);
+
+	/*
+		The functions below compute the source image coordinate of each destination pixel.
+		"buildMap" handles all of the camera (K, R) based types with the warp engine of the type's projection.
+	*/
+	void buildMap(PanoramaType type, Size sourceSize, Rect roi, Mat K, Mat R, WarpMap& warpMap);
+
+	void buildPerspectiveMap(Size sourceSize, Rect roi, Mat H, WarpMap& warpMap);
+
+	/*
+		Resamples the source image with the warp map using bilinear interpolation
+		and gives the warped image and warped mask.
+		* gains -> optional gain map of the warped image (CV_32F, one value per block, see GainCompensator),
+		  the gains are applied by the sampler.
+	*/
+	void apply(const Mat& image, const WarpMap& warpMap, Mat& warped_image, Mat& warped_mask, const Mat& gains = Mat());
+
+	/*
+		Samples the source image with a float warp map and adds each sample, weighted by its distance to the
+		border of the source image (feathering), to "sum" (CV_32FC3) and the weight to "weight_sum" (CV_32F),
+		starting at "offset". No warped image is created, a row of samples is blended as soon as it is read.
+		It runs on the calling thread, the caller decides how the areas are distributed among the threads.
+		* gains, roi -> optional gain map of the whole destination area "roi" of the image (see apply),
+		  the warp map may cover only a part of it.
+	*/
+	void composite(const Mat& image, const WarpMap& warpMap, Mat& sum, Mat& weight_sum, Point offset,
+		const Mat& gains = Mat(), Rect roi = Rect());
+
+	/*
+		Frees all of the maps kept in memory.
+	*/
+	void clearCache();
+
+private:
+	// Vectorized pixel kernels used to compute the maps.
+	WarpKernels kernels;
+
+	// Splits the destination images into tiles processed in parallel.
+	TileScheduler scheduler;
+
+	// Bilinear interpolation of the source images.
+	// The source images are mirrored around their borders (BORDER_REFLECT) without creating the mirrored images,
+	// so the warped images have no black area around them, which is important for multi-band blending.
+	Sampler sampler;
+
+	map<string, WarpMap> cache;
+	size_t cacheBytes = 0;
+
+	/*
+		Creates the unique key of a map from its parameters.
+	*/
+	string createKey(PanoramaType type, Size sourceSize, Rect roi, Mat K, Mat R);
+
+	/*
+		Projects all of the source image pixels to find the destination image area.
+		Each thread keeps its own minimum and maximum, they are merged once at the end.
+	*/
+	Rect scanRoi(PanoramaType type, Size imageSize, const double* M, double fx, double fy);
+
+	/*
+		Returns true if R is the identity or a rotation around the y axis only (yaw) and K has no skew.
+		A mirrored or not orthonormal R is not accepted.
+		The tolerance is small enough to keep the error of the separable cylindrical map below 1/100 pixel.
+	*/
+	bool isYawOnly(Mat K, Mat R);
+
+	/*
+		Cylindrical map of a level camera (see isYawOnly). With R = Ry(alpha) the mapping is separable:
+			x_src = fx * tan(theta + alpha) + cx                -> only depends on the column
+			y_src = fy * h / cos(theta + alpha) + cy            -> a per-column scale of the row height
+		so each row is made of 1D tables instead of the 3D math of each pixel.
+	*/
+	void buildYawCylindricalMap(Rect roi, Mat K, Mat R, const SourceWindow& window, WarpMap& warpMap);
+
+	/*
+		Interpolates the gains of "width" pixels of row y (starting at column x) of a destination image of
+		the given size between the centers of the blocks, in fixed-point for the sampler.
+	*/
+	void interpolateGains(const Mat& gains, Size size, int y, int x, int width, ushort* row_gains);
+
+	/*
+		Allocates the maps and the mask of the destination image.
+	*/
+	void prepareMap(Size sourceSize, Rect roi, WarpMap& warpMap);
+
+	/*
+		Returns the shift and the mask borders of the source image.
+	*/
+	SourceWindow getSourceWindow(Size sourceSize);
+};
+
+#endif
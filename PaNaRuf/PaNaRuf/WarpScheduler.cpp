@@ -0,0 +1,49 @@
+#include "WarpScheduler.h"
+
+void WarpScheduler::run(const vector<Rect>& rois, const function<void(int)>& warp) {
+	run(rois, vector<size_t>(), warp);
+}
+
+void WarpScheduler::run(const vector<Rect>& rois, const vector<size_t>& sourceBytes, const function<void(int)>& warp) {
+	int limit = (maxInFlight > 0) ? maxInFlight : 2 * omp_get_max_threads();
+
+	vector<int> batch;
+	size_t batchBytes = 0;
+	for (int i = 0; i < (int)rois.size(); i++) {
+		if (rois[i].empty())
+			continue;
+
+		// large images are warped alone, their tiles keep the threads busy.
+		if (rois[i].area() > largeImagePixels) {
+			runBatch(batch, rois, warp);
+			batchBytes = 0;
+			warp(i);
+			continue;
+		}
+
+		size_t bytes = size_t(rois[i].area()) * BYTES_PER_PIXEL;
+		if (i < (int)sourceBytes.size())
+			bytes += sourceBytes[i];
+		if (!batch.empty() && ((int)batch.size() >= limit || batchBytes + bytes > memoryBudgetBytes)) {
+			runBatch(batch, rois, warp);
+			batchBytes = 0;
+		}
+		batch.push_back(i);
+		batchBytes += bytes;
+	}
+	runBatch(batch, rois, warp);
+}
+
+void WarpScheduler::runBatch(vector<int>& batch, const vector<Rect>& rois, const function<void(int)>& warp) {
+	if (batch.empty())
+		return;
+
+	// The largest images start first, so the small ones fill the gaps at the end of the batch.
+	sort(batch.begin(), batch.end(), [&](int a, int b) { return rois[a].area() > rois[b].area(); });
+
+#pragma omp parallel for schedule(dynamic)
+	for (int k = 0; k < (int)batch.size(); k++) {
+		warp(batch[k]);
+	}
+	batch.clear();
+}
@@ -0,0 +1,63 @@
+#ifndef  WARP_SCHEDULER_H
+#define  WARP_SCHEDULER_H
+
+#include <iostream>
+#include <functional>
+#include <algorithm>
+#include <omp.h>
+#include <opencv2/core.hpp>
+
+using namespace std;
+using namespace cv;
+
+/*
+	This class decides which images are warped at the same time.
+
+	Small warped images do not have enough tiles to keep all of the threads busy, so they are
+	packed into batches and the images of a batch are warped concurrently (one image per thread,
+	the tile loop of an image is then sequential since nested parallelism is disabled).
+	Large warped images are warped alone with the tiles distributed among the threads.
+
+	A batch is closed when
+	* it contains "maxInFlight" images, or
+	* the estimated working memory (maps, warped image and mask, and the decoded source image) of its images
+	  exceeds "memoryBudgetBytes".
+*/
+class WarpScheduler {
+
+public:
+	// The working memory allowed for the images of a batch.
+	size_t memoryBudgetBytes = size_t(2) * 1024 * 1024 * 1024;
+
+	// Maximum number of images warped at the same time (0 -> twice the number of threads).
+	int maxInFlight = 0;
+
+	// Images having more pixels than this are warped alone.
+	int largeImagePixels = 1024 * 1024;
+
+	/*
+		Approximate number of bytes needed for a destination pixel while it is warped:
+		float maps (8) + fixed-point maps (6) + mask (1) + warped image (3) + warped mask (1)
+	*/
+	static const int BYTES_PER_PIXEL = 19;
+
+	/*
+		Calls "warp(i)" for each destination image area rois[i] which is not empty.
+		"warp" must only write to the outputs of the i-th image.
+	*/
+	void run(const vector<Rect>& rois, const function<void(int)>& warp);
+
+	/*
+		Same as above, "sourceBytes[i]" is the size of the source image which "warp(i)" decodes
+		(it is in memory while the image is warped, in addition to the destination pixels).
+	*/
+	void run(const vector<Rect>& rois, const vector<size_t>& sourceBytes, const function<void(int)>& warp);
+
+private:
+	/*
+		Warps the images of a batch concurrently, the largest ones first.
+	*/
+	void runBatch(vector<int>& batch, const vector<Rect>& rois, const function<void(int)>& warp);
+};
+
+#endif